@@ -0,0 +1,179 @@
+/**************************************************************************
+ * 3to4++ - https://github.com/rayzchen/3to4++
+ *-------------------------------------------------------------------------
+ * Copyright 2024 Ray Chen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ **************************************************************************/
+
+
+#include "movelog.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cstdlib>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+// Logs are converted one at a time by each thread, so memory stays at a
+// few logs however many there are
+struct ConvertJob {
+    std::vector<std::string> inputs;
+    std::vector<std::string> outputs;
+    std::atomic<size_t> next;
+    std::atomic<size_t> converted;
+    std::mutex mutex;
+};
+
+static bool isDirectory(const std::string& path) {
+    struct stat status;
+    return stat(path.c_str(), &status) == 0 && (status.st_mode & S_IFMT) == S_IFDIR;
+}
+
+// Names of the entries of a directory, leaving out hidden ones
+static bool listDirectory(const std::string& path, std::vector<std::string>& names) {
+#ifdef _WIN32
+    WIN32_FIND_DATAA entry;
+    HANDLE find = FindFirstFileA((path + "\\*").c_str(), &entry);
+    if (find == INVALID_HANDLE_VALUE) return false;
+    do {
+        if (entry.cFileName[0] != '.') names.push_back(entry.cFileName);
+    } while (FindNextFileA(find, &entry));
+    FindClose(find);
+#else
+    DIR *directory = opendir(path.c_str());
+    if (directory == NULL) return false;
+    while (struct dirent *entry = readdir(directory)) {
+        if (entry->d_name[0] != '.') names.push_back(entry->d_name);
+    }
+    closedir(directory);
+#endif
+    return true;
+}
+
+// Name without its extension
+static std::string getStem(const std::string& name) {
+    size_t dot = name.rfind('.');
+    return (dot == std::string::npos || dot == 0) ? name : name.substr(0, dot);
+}
+
+// Empty if the log was converted, otherwise why not
+// Outputs in a directory get the extension of the format they are
+// converted to, single outputs are named as given
+static std::string convertLog(const std::string& input, const std::string& output, bool addExtension) {
+    std::ifstream file(input, std::ios::binary);
+    if (!file.is_open()) return "could not read it";
+    std::string buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    // Reading changes the buffer, so Hyperspeedcube logs get a copy
+    std::string hscBuffer = buffer;
+    MoveLog log;
+    HscLog hscLog;
+    if (log.read(buffer)) {
+        if (!hscLog.fromMoves(log)) return "it does not start from its scramble";
+        if (!hscLog.write(output + (addExtension ? ".log" : ""))) return "could not write " + output;
+    } else if (hscLog.read(hscBuffer)) {
+        if (!log.fromHsc(hscLog)) return "it has twists the physical puzzle cannot make";
+        if (!log.write(output + (addExtension ? ".yml" : ""))) return "could not write " + output;
+    } else {
+        return "it is not a log";
+    }
+    return "";
+}
+
+static void worker(ConvertJob* job, bool toDirectory) {
+    while (true) {
+        size_t index = job->next++;
+        if (index >= job->inputs.size()) return;
+        std::string error = convertLog(job->inputs[index], job->outputs[index], toDirectory);
+        if (error.empty()) {
+            job->converted++;
+        } else {
+            std::lock_guard<std::mutex> lock(job->mutex);
+            std::cerr << "Skipped " << job->inputs[index] << ": " << error << std::endl;
+        }
+    }
+}
+
+static void printUsage(const char *name) {
+    std::cerr << "Usage: " << name << " [options] INPUT OUTPUT\n"
+              << "  INPUT       a log, or a directory of logs\n"
+              << "  OUTPUT      the converted log, or an existing directory for them\n"
+              << "  -j THREADS  worker threads (default: all cores)\n"
+              << "3to4++ logs become Hyperspeedcube logs (.log) and the other way round (.yml).\n";
+}
+
+int main(int argc, char *argv[]) {
+    unsigned int threads = std::thread::hardware_concurrency();
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        bool hasValue = i + 1 < argc;
+        if (arg == "-j" && hasValue) {
+            threads = std::atoi(argv[++i]);
+        } else if (arg.size() && arg[0] != '-' && paths.size() < 2) {
+            paths.push_back(arg);
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (paths.size() != 2) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (threads == 0) threads = 1;
+
+    ConvertJob job;
+    job.next = 0;
+    job.converted = 0;
+    bool toDirectory = isDirectory(paths[0]);
+    if (toDirectory) {
+        if (!isDirectory(paths[1])) {
+            std::cerr << paths[1] << " is not a directory" << std::endl;
+            return 1;
+        }
+        std::vector<std::string> names;
+        if (!listDirectory(paths[0], names)) {
+            std::cerr << "Could not read " << paths[0] << std::endl;
+            return 1;
+        }
+        for (size_t i = 0; i < names.size(); i++) {
+            std::string input = paths[0] + "/" + names[i];
+            if (isDirectory(input)) continue;
+            job.inputs.push_back(input);
+            job.outputs.push_back(paths[1] + "/" + getStem(names[i]));
+        }
+    } else {
+        job.inputs.push_back(paths[0]);
+        job.outputs.push_back(paths[1]);
+    }
+
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0; i < threads && i < job.inputs.size(); i++) {
+        workers.push_back(std::thread(worker, &job, toDirectory));
+    }
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+    std::cerr << "Converted " << job.converted << " of " << job.inputs.size() << " logs" << std::endl;
+    return job.converted == job.inputs.size() ? 0 : 1;
+}
@@ -0,0 +1,399 @@
+/**************************************************************************
+ * 3to4++ - https://github.com/rayzchen/3to4++
+ *-------------------------------------------------------------------------
+ * Copyright 2024 Ray Chen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ **************************************************************************/
+
+#include "scrambler.h"
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <set>
+#include <thread>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+
+// Walks handed out to a thread at a time
+#define CHUNK_SIZE 1024
+#define DEFAULT_LENGTH 45
+
+static const int factorial[] = {1, 1, 2, 6, 24};
+static const char *orbitNames[] = {"", "1c", "2c", "3c", "4c"};
+
+// Every slot's content is counted as (piece, twist), numbered within its
+// orbit as piece * size! + twist
+struct SlotTables {
+    std::array<int, NUM_SLOTS> size;
+    std::array<int, NUM_SLOTS> base;
+    // Start of each slot's outcomes within one length's counters
+    std::array<int, NUM_SLOTS> offset;
+    std::array<int, NUM_SLOTS> localPiece;
+    // Piece and sticker index of every home position
+    std::array<int, NUM_STICKERS> pieceOf;
+    std::array<int, NUM_STICKERS> stickerOf;
+    // Twist of a slot from its sticker indices packed two bits each
+    std::array<std::array<int, 256>, 5> twistOf;
+    int outcomes;
+
+    SlotTables();
+    int outcome(const PuzzleState& state, int slot) const;
+};
+
+SlotTables::SlotTables() {
+    outcomes = 0;
+    for (int i = 0; i < NUM_SLOTS; i++) {
+        size[i] = PuzzleState::getSlotSize(i);
+        base[i] = PuzzleState::getSlotSticker(i);
+        offset[i] = outcomes;
+        for (int j = 0; j < size[i]; j++) {
+            pieceOf[base[i] + j] = i;
+            stickerOf[base[i] + j] = j;
+        }
+        outcomes += PuzzleState::getOrbit(size[i]).size() * factorial[size[i]];
+    }
+    for (int orbitSize = 1; orbitSize <= 4; orbitSize++) {
+        std::vector<int> orbit = PuzzleState::getOrbit(orbitSize);
+        for (size_t i = 0; i < orbit.size(); i++) {
+            localPiece[orbit[i]] = i;
+        }
+        twistOf[orbitSize].fill(0);
+        unsigned char perm[4];
+        for (int twist = 0; twist < factorial[orbitSize]; twist++) {
+            PuzzleState::unrankPermutation(twist, perm, orbitSize);
+            int packed = 0;
+            for (int j = 0; j < orbitSize; j++) {
+                packed |= perm[j] << (2 * j);
+            }
+            twistOf[orbitSize][packed] = twist;
+        }
+    }
+}
+
+int SlotTables::outcome(const PuzzleState& state, int slot) const {
+    const unsigned char *stickers = state.stickers.data() + base[slot];
+    int packed = 0;
+    for (int j = 0; j < size[slot]; j++) {
+        packed |= stickerOf[stickers[j]] << (2 * j);
+    }
+    return localPiece[pieceOf[stickers[0]]] * factorial[size[slot]] + twistOf[size[slot]][packed];
+}
+
+struct MixingJob {
+    unsigned long long walks;
+    unsigned long long seed;
+    int maxLength;
+    std::vector<double> typeWeights;
+    std::vector<double> cellWeights;
+    const SlotTables *tables;
+
+    std::atomic<unsigned long long> nextChunk;
+    // Per thread counters, indexed by (length - 1) * outcomes + outcome
+    std::vector<std::vector<unsigned int> > counts;
+};
+
+static void worker(MixingJob* job, int thread) {
+    const SlotTables& tables = *job->tables;
+    std::vector<unsigned int>& counts = job->counts[thread];
+    counts.assign((size_t)job->maxLength * tables.outcomes, 0);
+    unsigned long long numChunks = (job->walks + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    while (true) {
+        unsigned long long chunk = job->nextChunk++;
+        if (chunk >= numChunks) return;
+        unsigned long long end = std::min(job->walks, (chunk + 1) * CHUNK_SIZE);
+        for (unsigned long long walk = chunk * CHUNK_SIZE; walk < end; walk++) {
+            // A scramble of n moves is a prefix of a longer one from the same stream
+            SplitMix64 rng(job->seed, walk);
+            std::vector<MoveEntry> scramble = Scrambler::randomMoves(job->maxLength, rng, job->typeWeights, job->cellWeights);
+            PuzzleState state;
+            int length = 0;
+            for (size_t i = 0; i < scramble.size(); i++) {
+                const std::vector<MoveCode>& codes = state.expandMove(PuzzleState::getMoveCode(scramble[i]));
+                for (size_t j = 0; j < codes.size(); j++) {
+                    state.applyMove(codes[j]);
+                }
+                if (scramble[i].type != TURN) continue;
+                unsigned int *row = counts.data() + (size_t)length * tables.outcomes;
+                for (int slot = 0; slot < NUM_SLOTS; slot++) {
+                    row[tables.offset[slot] + tables.outcome(state, slot)]++;
+                }
+                length++;
+            }
+        }
+    }
+}
+
+// Outcomes a slot can hold in some reachable state. Under a uniformly random
+// state every one of them is equally likely.
+static std::vector<bool> findReachable(const SlotTables& tables, int slot) {
+    std::vector<const unsigned char*> generators;
+    for (int move = 0; move < NUM_MOVES; move++) {
+        generators.push_back(PuzzleState::getMovePermutation(move));
+    }
+    int size = tables.size[slot];
+    std::vector<std::array<unsigned char, 4> > queue(1);
+    for (int j = 0; j < size; j++) {
+        queue[0][j] = tables.base[slot] + j;
+    }
+    std::set<std::array<unsigned char, 4> > seen(queue.begin(), queue.end());
+    std::vector<bool> reachable(PuzzleState::getOrbit(size).size() * factorial[size], false);
+    PuzzleState state;
+    for (size_t i = 0; i < queue.size(); i++) {
+        std::copy(queue[i].begin(), queue[i].begin() + size, state.stickers.begin() + tables.base[slot]);
+        reachable[tables.outcome(state, slot)] = true;
+        for (size_t j = 0; j < generators.size(); j++) {
+            std::array<unsigned char, 4> image = queue[i];
+            for (int k = 0; k < size; k++) {
+                image[k] = generators[j][queue[i][k]];
+            }
+            if (seen.insert(image).second) queue.push_back(image);
+        }
+    }
+    return reachable;
+}
+
+// Total variation distance of one slot from uniform: of the whole outcome,
+// of the piece alone and of the twist alone. floor is the distance expected
+// from sampling noise alone.
+struct Distance {
+    double joint, position, twist, floor;
+};
+
+// Mean absolute error of a frequency estimate, from the normal approximation
+static double noise(double p, double walks) {
+    static const double pi = 3.14159265358979323846;
+    return std::sqrt(2.0 * p * (1.0 - p) / (pi * walks));
+}
+
+static Distance slotDistance(const unsigned long long *counts, const std::vector<bool>& reachable,
+                             int size, double walks) {
+    int twists = factorial[size];
+    int pieces = reachable.size() / twists;
+    std::vector<double> positionCounts(pieces, 0), positionUniform(pieces, 0);
+    std::vector<double> twistCounts(twists, 0), twistUniform(twists, 0);
+    int numReachable = 0;
+    for (size_t i = 0; i < reachable.size(); i++) {
+        numReachable += reachable[i];
+    }
+    Distance distance = {0, 0, 0, 0};
+    for (size_t i = 0; i < reachable.size(); i++) {
+        double expected = reachable[i] ? 1.0 / numReachable : 0.0;
+        distance.joint += std::fabs(counts[i] / walks - expected);
+        distance.floor += noise(expected, walks);
+        positionCounts[i / twists] += counts[i];
+        positionUniform[i / twists] += expected;
+        twistCounts[i % twists] += counts[i];
+        twistUniform[i % twists] += expected;
+    }
+    for (int i = 0; i < pieces; i++) {
+        distance.position += std::fabs(positionCounts[i] / walks - positionUniform[i]);
+    }
+    for (int i = 0; i < twists; i++) {
+        distance.twist += std::fabs(twistCounts[i] / walks - twistUniform[i]);
+    }
+    distance.joint /= 2;
+    distance.position /= 2;
+    distance.twist /= 2;
+    distance.floor /= 2;
+    return distance;
+}
+
+static bool parseWeights(const char *text, std::vector<double>& weights, size_t count) {
+    weights.clear();
+    char *end;
+    while (true) {
+        double weight = std::strtod(text, &end);
+        if (end == text || weight < 0) return false;
+        weights.push_back(weight);
+        if (*end != ',') break;
+        text = end + 1;
+    }
+    return *end == '\0' && weights.size() == count;
+}
+
+static void printUsage(const char *name) {
+    std::cerr << "Usage: " << name << " [options]\n"
+              << "  -n WALKS    random move scrambles to sample (default 100000)\n"
+              << "  -l LENGTH   longest scramble length to measure (default 100)\n"
+              << "  -e EPSILON  distance above the noise floor counted as mixed (default 0.01)\n"
+              << "  -t WEIGHTS  gyro and turn weights (default 2,3)\n"
+              << "  -c WEIGHTS  cell weights, IN to BACK (default 2,2,6,6,1,1,1,1)\n"
+              << "  -s SEED     seed, the same seed gives the same walks\n"
+              << "  -j THREADS  worker threads (default: all cores)\n"
+              << "  -o FILE     also write every distance as CSV\n";
+}
+
+int main(int argc, char *argv[]) {
+    MixingJob job;
+    job.walks = 100000;
+    job.maxLength = 100;
+    job.typeWeights = {2, 3};
+    job.cellWeights = {2, 2, 6, 6, 1, 1, 1, 1};
+    job.seed = ((unsigned long long)std::random_device()() << 32) | std::random_device()();
+    double epsilon = 0.01;
+    unsigned int threads = std::thread::hardware_concurrency();
+    std::string filename;
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        bool hasValue = i + 1 < argc;
+        bool valid = true;
+        if (arg == "-n" && hasValue) {
+            job.walks = std::strtoull(argv[++i], NULL, 10);
+        } else if (arg == "-l" && hasValue) {
+            job.maxLength = std::atoi(argv[++i]);
+        } else if (arg == "-e" && hasValue) {
+            epsilon = std::atof(argv[++i]);
+        } else if (arg == "-t" && hasValue) {
+            valid = parseWeights(argv[++i], job.typeWeights, 2);
+        } else if (arg == "-c" && hasValue) {
+            valid = parseWeights(argv[++i], job.cellWeights, 8);
+        } else if (arg == "-s" && hasValue) {
+            job.seed = std::strtoull(argv[++i], NULL, 10);
+        } else if (arg == "-j" && hasValue) {
+            threads = std::atoi(argv[++i]);
+        } else if (arg == "-o" && hasValue) {
+            filename = argv[++i];
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (job.walks == 0 || job.maxLength <= 0) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (threads == 0) threads = 1;
+
+    std::ofstream csv;
+    if (filename.size()) {
+        csv.open(filename);
+        if (!csv.is_open()) {
+            std::cerr << "Could not open " << filename << std::endl;
+            return 1;
+        }
+        csv << "length,slot,orbit,joint,position,twist,floor\n";
+    }
+
+    SlotTables tables;
+    job.tables = &tables;
+    job.nextChunk = 0;
+    job.counts.resize(threads);
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0; i < threads; i++) {
+        workers.push_back(std::thread(worker, &job, i));
+    }
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+    std::vector<unsigned long long> counts(job.counts[0].size(), 0);
+    for (size_t i = 0; i < job.counts.size(); i++) {
+        for (size_t j = 0; j < counts.size(); j++) {
+            counts[j] += job.counts[i][j];
+        }
+        std::vector<unsigned int>().swap(job.counts[i]);
+    }
+
+    std::vector<std::vector<bool> > reachable(NUM_SLOTS);
+    for (int slot = 0; slot < NUM_SLOTS; slot++) {
+        reachable[slot] = findReachable(tables, slot);
+    }
+
+    // Orbit averages of each distance, by length
+    std::vector<std::array<Distance, 5> > averages(job.maxLength + 1);
+    for (int length = 1; length <= job.maxLength; length++) {
+        Distance zero = {0, 0, 0, 0};
+        averages[length].fill(zero);
+        for (int slot = 0; slot < NUM_SLOTS; slot++) {
+            int size = tables.size[slot];
+            const unsigned long long *row = counts.data() + (size_t)(length - 1) * tables.outcomes + tables.offset[slot];
+            Distance distance = slotDistance(row, reachable[slot], size, job.walks);
+            double weight = 1.0 / PuzzleState::getOrbit(size).size();
+            averages[length][size].joint += distance.joint * weight;
+            averages[length][size].position += distance.position * weight;
+            averages[length][size].twist += distance.twist * weight;
+            averages[length][size].floor += distance.floor * weight;
+            if (csv.is_open()) {
+                csv << length << "," << slot << "," << orbitNames[size] << ","
+                    << distance.joint << "," << distance.position << ","
+                    << distance.twist << "," << distance.floor << "\n";
+            }
+        }
+    }
+
+    std::cout << "# seed " << job.seed << ", " << job.walks << " walks\n"
+              << "# mean total variation distance from uniform per orbit\n"
+              << "length";
+    for (int size = 1; size <= 4; size++) {
+        std::cout << std::setw(10) << orbitNames[size];
+    }
+    std::cout << "\n" << std::fixed << std::setprecision(4);
+    for (int length = 1; length <= job.maxLength; length++) {
+        std::cout << std::setw(6) << length;
+        for (int size = 1; size <= 4; size++) {
+            std::cout << std::setw(10) << averages[length][size].joint;
+        }
+        std::cout << "\n";
+    }
+    std::cout << std::setw(6) << "floor";
+    for (int size = 1; size <= 4; size++) {
+        std::cout << std::setw(10) << averages[job.maxLength][size].floor;
+    }
+    std::cout << "\n\n";
+
+    // Mixed from the first length that stays within epsilon of the floor
+    std::cout << "# shortest mixed length (position, twist, both)\n";
+    int longest = 0;
+    for (int size = 1; size <= 4; size++) {
+        int mixed[3];
+        for (int i = 0; i < 3; i++) {
+            mixed[i] = 0;
+            for (int length = job.maxLength; length >= 1; length--) {
+                const Distance& distance = averages[length][size];
+                double values[3] = {distance.position, distance.twist, distance.joint};
+                if (values[i] > distance.floor + epsilon) break;
+                mixed[i] = length;
+            }
+        }
+        std::cout << orbitNames[size];
+        for (int i = 0; i < 3; i++) {
+            if (mixed[i]) {
+                std::cout << std::setw(8) << mixed[i];
+            } else {
+                std::cout << std::setw(8) << ">" + std::to_string(job.maxLength);
+            }
+        }
+        std::cout << "\n";
+        longest = (mixed[2] && longest >= 0) ? std::max(longest, mixed[2]) : -1;
+    }
+    if (longest > 0) {
+        std::cout << "every orbit is mixed after " << longest << " moves\n";
+    } else {
+        std::cout << "not every orbit is mixed within " << job.maxLength << " moves\n";
+    }
+    if (job.maxLength >= DEFAULT_LENGTH) {
+        std::cout << "at the default " << DEFAULT_LENGTH << " moves:";
+        for (int size = 1; size <= 4; size++) {
+            std::cout << " " << orbitNames[size] << " " << averages[DEFAULT_LENGTH][size].joint;
+        }
+        std::cout << "\n";
+    }
+    return std::cout ? 0 : 1;
+}
@@ -0,0 +1,65 @@
+/**************************************************************************
+ * 3to4++ - https://github.com/rayzchen/3to4++
+ *-------------------------------------------------------------------------
+ * Copyright 2024 Ray Chen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ **************************************************************************/
+
+#include "solver.h"
+#include <iostream>
+#include <string>
+#include <chrono>
+
+static void printUsage(const char *name) {
+    std::cerr << "Usage: " << name << " [options] DIRECTORY\n"
+              << "  Builds the solver's pattern databases into DIRECTORY, skipping\n"
+              << "  tables already there and rebuilding stale or corrupt ones\n"
+              << "  -m METRIC   turn (default) or physical\n";
+}
+
+int main(int argc, char *argv[]) {
+    SolverMetric metric = SolverMetric::turnMetric();
+    std::string directory;
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        bool hasValue = i + 1 < argc;
+        if (arg == "-m" && hasValue && std::string(argv[i + 1]) == "turn") {
+            metric = SolverMetric::turnMetric();
+            i++;
+        } else if (arg == "-m" && hasValue && std::string(argv[i + 1]) == "physical") {
+            metric = SolverMetric::physicalMetric();
+            i++;
+        } else if (arg.size() && arg[0] != '-' && directory.empty()) {
+            directory = arg;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (directory.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    Solver solver(metric, directory);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "tables ready in " << seconds << " s" << std::endl;
+    if (!solver.saveDatabases(directory)) {
+        std::cerr << "Could not write tables to " << directory << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,202 @@
+/**************************************************************************
+ * 3to4++ - https://github.com/rayzchen/3to4++
+ *-------------------------------------------------------------------------
+ * Copyright 2024 Ray Chen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ **************************************************************************/
+
+#include "scrambler.h"
+#include "solver.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <cstdlib>
+#include <algorithm>
+
+// Scrambles are generated in chunks so threads rarely touch the lock.
+// Random states take a staged solve each, so they are handed out one at a
+// time to keep every thread busy even for a few of them.
+#define CHUNK_SIZE 1024
+#define STATE_CHUNK_SIZE 1
+// Chunks allowed to wait for the writer before workers block
+#define MAX_PENDING_CHUNKS 64
+
+struct ScrambleJob {
+    unsigned long long count;
+    unsigned long long seed;
+    int length;
+    const Scrambler *scrambler;
+    unsigned long long chunkSize;
+    // Random states no moves were found for, left out of the output
+    std::atomic<unsigned long long> failed;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    unsigned long long nextChunk;
+    unsigned long long writtenChunks;
+    std::vector<std::string> chunks;
+    std::vector<bool> done;
+};
+
+// Random states get moves to them from the solver, one per worker
+static void generateChunk(ScrambleJob& job, Solver* solver, unsigned long long chunk, std::string& output) {
+    unsigned long long end = std::min(job.count, (chunk + 1) * job.chunkSize);
+    for (unsigned long long index = chunk * job.chunkSize; index < end; index++) {
+        SplitMix64 rng(job.seed, index);
+        std::vector<MoveEntry> scramble;
+        std::string header = "--- # " + std::to_string(index) + "\n";
+        if (job.scrambler != NULL) {
+            PuzzleState state = job.scrambler->randomState(rng);
+            std::vector<MoveCode> moves;
+            if (!solver->getScramble(state, moves)) {
+                job.failed++;
+                continue;
+            }
+            header += "state: " + state.encode() + "\n";
+            PuzzleState solved;
+            for (size_t i = 0; i < moves.size(); i++) {
+                scramble.push_back(solved.getMoveEntry(moves[i]));
+            }
+        } else {
+            scramble = Scrambler::randomMoves(job.length, rng);
+        }
+        output += header;
+        output += "scramble: >\n  " + Scrambler::getHscScramble(scramble) + "\n";
+        output += "phys_scramble: >\n  " + Scrambler::getPhysScramble(scramble) + "\n";
+    }
+}
+
+static void worker(ScrambleJob* job) {
+    std::unique_ptr<Solver> solver(job->scrambler != NULL ? new Solver() : NULL);
+    unsigned long long numChunks = job->chunks.size();
+    while (true) {
+        unsigned long long chunk;
+        {
+            std::unique_lock<std::mutex> lock(job->mutex);
+            job->changed.wait(lock, [job, numChunks]() {
+                return job->nextChunk >= numChunks || job->nextChunk < job->writtenChunks + MAX_PENDING_CHUNKS;
+            });
+            if (job->nextChunk >= numChunks) return;
+            chunk = job->nextChunk++;
+        }
+        std::string output;
+        generateChunk(*job, solver.get(), chunk, output);
+        {
+            std::lock_guard<std::mutex> lock(job->mutex);
+            job->chunks[chunk].swap(output);
+            job->done[chunk] = true;
+        }
+        job->changed.notify_all();
+    }
+}
+
+static void printUsage(const char *name) {
+    std::cerr << "Usage: " << name << " [options]\n"
+              << "  -n COUNT    number of scrambles (default 1)\n"
+              << "  -l LENGTH   moves per random move scramble (default 45)\n"
+              << "  -r          random state scrambles instead of random moves, with the\n"
+              << "              moves to each from a staged solve: about 2000 moves and\n"
+              << "              0.2 s per scramble\n"
+              << "  -s SEED     seed, the same seed gives the same scrambles\n"
+              << "  -j THREADS  worker threads (default: all cores)\n"
+              << "  -o FILE     output file (default: standard output)\n";
+}
+
+int main(int argc, char *argv[]) {
+    unsigned long long count = 1;
+    int length = 0;
+    bool randomState = false;
+    unsigned long long seed = ((unsigned long long)std::random_device()() << 32) | std::random_device()();
+    unsigned int threads = std::thread::hardware_concurrency();
+    std::string filename;
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        bool hasValue = i + 1 < argc;
+        if (arg == "-n" && hasValue) {
+            count = std::strtoull(argv[++i], NULL, 10);
+        } else if (arg == "-l" && hasValue) {
+            length = std::atoi(argv[++i]);
+        } else if (arg == "-r") {
+            randomState = true;
+        } else if (arg == "-s" && hasValue) {
+            seed = std::strtoull(argv[++i], NULL, 10);
+        } else if (arg == "-j" && hasValue) {
+            threads = std::atoi(argv[++i]);
+        } else if (arg == "-o" && hasValue) {
+            filename = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (threads == 0) threads = 1;
+
+    std::ofstream file;
+    if (filename.size()) {
+        file.open(filename);
+        if (!file.is_open()) {
+            std::cerr << "Could not open " << filename << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = filename.size() ? file : std::cout;
+
+    Scrambler *scrambler = randomState ? new Scrambler() : NULL;
+    ScrambleJob job;
+    job.count = count;
+    job.seed = seed;
+    job.length = length;
+    job.scrambler = scrambler;
+    job.chunkSize = randomState ? STATE_CHUNK_SIZE : CHUNK_SIZE;
+    job.failed = 0;
+    job.nextChunk = 0;
+    job.writtenChunks = 0;
+    job.chunks.resize((count + job.chunkSize - 1) / job.chunkSize);
+    job.done.resize(job.chunks.size(), false);
+
+    out << "# seed " << seed << "\n";
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0; i < threads; i++) {
+        workers.push_back(std::thread(worker, &job));
+    }
+    // Write chunks in order as they finish
+    for (size_t chunk = 0; chunk < job.chunks.size(); chunk++) {
+        std::string output;
+        {
+            std::unique_lock<std::mutex> lock(job.mutex);
+            job.changed.wait(lock, [&job, chunk]() { return job.done[chunk]; });
+            job.chunks[chunk].swap(output);
+            job.writtenChunks++;
+        }
+        job.changed.notify_all();
+        out << output;
+    }
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+    out.flush();
+    delete scrambler;
+    if (job.failed > 0) {
+        std::cerr << "Left out " << job.failed << " random states no moves were found for" << std::endl;
+        return 1;
+    }
+    return out ? 0 : 1;
+}
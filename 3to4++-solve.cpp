@@ -0,0 +1,170 @@
+/**************************************************************************
+ * 3to4++ - https://github.com/rayzchen/3to4++
+ *-------------------------------------------------------------------------
+ * Copyright 2024 Ray Chen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ **************************************************************************/
+
+#include "solver.h"
+#include "scrambler.h"
+#include "notation.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+static void printUsage(const char *name) {
+    std::cerr << "Usage: " << name << " [options] [STATE...]\n"
+              << "  STATE       state code, as written by 3to4++-scramble -r\n"
+              << "  -l LENGTH   solve a random move scramble of this length instead\n"
+              << "  -s SEED     seed for -l\n"
+              << "  -a MOVES    solve the position an algorithm leaves, such as \"[Rx, Uy]3\"\n"
+              << "  -m METRIC   turn (default) or physical, which counts slice gyros\n"
+              << "  -o          optimal solutions only\n"
+              << "  -S          staged solver only, without the beam search\n"
+              << "  -w WIDTH    states the beam search keeps at each depth\n"
+              << "  -M MB       memory the beam search may use\n"
+              << "  -n NODES    give up optimal searches after this many nodes\n"
+              << "  -d DIR      use the bigger tables written there by 3to4++-pdb\n"
+              << "  -j THREADS  threads for searches (default: all cores)\n";
+}
+
+int main(int argc, char *argv[]) {
+    int length = -1;
+    unsigned long long seed = ((unsigned long long)std::random_device()() << 32) | std::random_device()();
+    SolverMetric metric = SolverMetric::turnMetric();
+    bool optimal = false;
+    bool staged = false;
+    size_t width = 0;
+    size_t memory = 0;
+    unsigned long long maxNodes = 0;
+    std::string directory;
+    unsigned int threads = std::thread::hardware_concurrency();
+    std::vector<std::string> codes;
+    std::vector<std::string> algorithms;
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        bool hasValue = i + 1 < argc;
+        if (arg == "-l" && hasValue) {
+            length = std::atoi(argv[++i]);
+        } else if (arg == "-s" && hasValue) {
+            seed = std::strtoull(argv[++i], NULL, 10);
+        } else if (arg == "-a" && hasValue) {
+            algorithms.push_back(argv[++i]);
+        } else if (arg == "-m" && hasValue && std::string(argv[i + 1]) == "turn") {
+            metric = SolverMetric::turnMetric();
+            i++;
+        } else if (arg == "-m" && hasValue && std::string(argv[i + 1]) == "physical") {
+            metric = SolverMetric::physicalMetric();
+            i++;
+        } else if (arg == "-o") {
+            optimal = true;
+        } else if (arg == "-S") {
+            staged = true;
+        } else if (arg == "-w" && hasValue) {
+            width = std::strtoull(argv[++i], NULL, 10);
+        } else if (arg == "-M" && hasValue) {
+            memory = std::strtoull(argv[++i], NULL, 10) << 20;
+        } else if (arg == "-n" && hasValue) {
+            maxNodes = std::strtoull(argv[++i], NULL, 10);
+        } else if (arg == "-d" && hasValue) {
+            directory = argv[++i];
+        } else if (arg == "-j" && hasValue) {
+            threads = std::atoi(argv[++i]);
+        } else if (arg.size() && arg[0] != '-') {
+            codes.push_back(arg);
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<PuzzleState> states;
+    if (length >= 0) {
+        SplitMix64 rng(seed, 0);
+        std::vector<MoveEntry> scramble = Scrambler::randomMoves(length, rng);
+        std::cout << "scramble: " << Scrambler::getPhysScramble(scramble) << "\n";
+        PuzzleState state;
+        for (size_t i = 0; i < scramble.size(); i++) {
+            const std::vector<MoveCode>& moves = state.expandMove(PuzzleState::getMoveCode(scramble[i]));
+            for (size_t j = 0; j < moves.size(); j++) {
+                state.applyMove(moves[j]);
+            }
+        }
+        states.push_back(state);
+    }
+    for (size_t i = 0; i < codes.size(); i++) {
+        PuzzleState state;
+        if (!state.decode(codes[i])) {
+            std::cerr << "Invalid state " << codes[i] << std::endl;
+            return 1;
+        }
+        states.push_back(state);
+    }
+    for (size_t i = 0; i < algorithms.size(); i++) {
+        const std::string& text = algorithms[i];
+        std::vector<MoveCode> moves;
+        size_t errorOffset;
+        std::string error;
+        if (!Notation::parse(text.data(), text.size(), moves, errorOffset, error)) {
+            std::cerr << "Invalid algorithm " << text << ": " << error << " at character " << errorOffset + 1 << std::endl;
+            return 1;
+        }
+        PuzzleState state;
+        if (Notation::apply(moves, state) < moves.size()) {
+            std::cerr << "Algorithm " << text << " cannot be played from solved" << std::endl;
+            return 1;
+        }
+        states.push_back(state);
+    }
+    if (states.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    Solver solver(metric, directory);
+    solver.setThreads(threads);
+    if (width) solver.setBeamWidth(width);
+    if (memory) solver.setBeamMemory(memory);
+    for (size_t i = 0; i < states.size(); i++) {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<MoveCode> solution;
+        bool solved;
+        if (optimal) {
+            solved = solver.solveOptimal(states[i], solution, maxNodes);
+        } else if (staged) {
+            solved = solver.solveStaged(states[i], solution);
+        } else {
+            solved = solver.solveBeam(states[i], solution);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (!solved) {
+            std::cout << "no solution found (" << solver.getNodes() << " nodes, " << seconds << " s)\n";
+            continue;
+        }
+        // Slice gyros are left for the controller to fill in
+        std::vector<MoveEntry> moves;
+        for (size_t j = 0; j < solution.size(); j++) {
+            moves.push_back(states[i].getMoveEntry(solution[j]));
+        }
+        std::cout << "solution: " << Scrambler::getPhysScramble(moves) << "\n"
+                  << "cost " << solver.getCost(states[i], solution) << ", "
+                  << Solver::getMoveEntries(states[i], solution).size() << " moves with slice gyros, "
+                  << seconds << " s\n";
+    }
+    return 0;
+}
@@ -0,0 +1,320 @@
+/**************************************************************************
+ * 3to4++ - https://github.com/rayzchen/3to4++
+ *-------------------------------------------------------------------------
+ * Copyright 2024 Ray Chen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ **************************************************************************/
+
+#include "scrambler.h"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+// States handed between threads and the frontiers at a time
+#define CHUNK_SIZE 4096
+
+// States of one BFS level. Chunks go to memory until the limit, then to a
+// temporary file, and are read back in the same way.
+class Frontier {
+    public:
+        Frontier(size_t memoryLimit) : memoryLimit(memoryLimit), next(0), spill(NULL), spilled(0), read(0) {}
+        ~Frontier() {
+            if (spill != NULL) fclose(spill);
+        }
+
+        bool add(const std::vector<unsigned long long>& chunk) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (states.size() + chunk.size() <= memoryLimit) {
+                states.insert(states.end(), chunk.begin(), chunk.end());
+                return true;
+            }
+            if (spill == NULL) spill = std::tmpfile();
+            if (spill == NULL) return false;
+            spilled += chunk.size();
+            return fwrite(chunk.data(), sizeof(chunk[0]), chunk.size(), spill) == chunk.size();
+        }
+
+        // Switches from adding to taking
+        void rewind() {
+            if (spill != NULL) std::rewind(spill);
+        }
+
+        bool take(std::vector<unsigned long long>& chunk) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (next < states.size()) {
+                size_t end = std::min(states.size(), next + CHUNK_SIZE);
+                chunk.assign(states.begin() + next, states.begin() + end);
+                next = end;
+                return true;
+            }
+            if (read == spilled) return false;
+            chunk.resize(std::min<unsigned long long>(spilled - read, CHUNK_SIZE));
+            chunk.resize(fread(chunk.data(), sizeof(chunk[0]), chunk.size(), spill));
+            read += chunk.size();
+            return chunk.size() > 0;
+        }
+
+        unsigned long long size() const { return states.size() + spilled; }
+        unsigned long long getSpilled() const { return spilled; }
+
+    private:
+        std::mutex mutex;
+        size_t memoryLimit;
+        std::vector<unsigned long long> states;
+        size_t next;
+        FILE *spill;
+        unsigned long long spilled;
+        unsigned long long read;
+};
+
+struct Enumeration {
+    const Scrambler *group;
+    std::vector<StickerPermutation> perms;
+    // Whether each move can be played from each slice config, and the
+    // config it leaves
+    std::vector<std::vector<bool> > legal;
+    std::vector<std::vector<int> > nextConfig;
+    int numConfigs;
+
+    // One bit per group element and config, set once it has been reached
+    std::unique_ptr<std::atomic<unsigned long long>[]> visited;
+    Frontier *current;
+    Frontier *next;
+    std::atomic<bool> failed;
+};
+
+static void expand(Enumeration* job) {
+    std::vector<unsigned long long> chunk, found;
+    while (job->current->take(chunk)) {
+        for (size_t i = 0; i < chunk.size(); i++) {
+            int config = chunk[i] % job->numConfigs;
+            for (size_t m = 0; m < job->perms.size(); m++) {
+                if (!job->legal[config][m]) continue;
+                unsigned long long index = job->group->getProductIndex(chunk[i] / job->numConfigs, job->perms[m]);
+                index = index * job->numConfigs + job->nextConfig[config][m];
+                unsigned long long bit = 1ULL << (index % 64);
+                if (job->visited[index / 64].fetch_or(bit) & bit) continue;
+                found.push_back(index);
+                if (found.size() < CHUNK_SIZE) continue;
+                if (!job->next->add(found)) job->failed = true;
+                found.clear();
+            }
+        }
+    }
+    if (found.size() && !job->next->add(found)) job->failed = true;
+}
+
+// Move codes named on the command line
+static bool addMoves(const std::string& name, std::vector<MoveCode>& moves) {
+    static const char *cells[] = {"IN", "OUT", "RIGHT", "LEFT", "UP", "DOWN", "FRONT", "BACK"};
+    for (int cell = 0; cell < 8; cell++) {
+        if (name != cells[cell]) continue;
+        PuzzleState state;
+        for (int move = MOVE_TURN; move < MOVE_GYRO; move++) {
+            if (state.getMoveEntry(move).cell == cell) moves.push_back(move);
+        }
+        return true;
+    }
+    int first, last;
+    if (name == "GYRO") {
+        first = MOVE_GYRO;
+        last = MOVE_GYRO_OUTER;
+    } else if (name == "GYRO_OUTER") {
+        first = MOVE_GYRO_OUTER;
+        last = MOVE_GYRO_MIDDLE;
+    } else if (name == "GYRO_MIDDLE") {
+        first = MOVE_GYRO_MIDDLE;
+        last = MOVE_ROTATE;
+    } else if (name == "ROTATE") {
+        first = MOVE_ROTATE;
+        last = NUM_MOVES;
+    } else {
+        return false;
+    }
+    for (int move = first; move < last; move++) {
+        moves.push_back(move);
+    }
+    return true;
+}
+
+static void printUsage(const char *name) {
+    std::cerr << "Usage: " << name << " [options]\n"
+              << "  -m MOVES    comma separated moves generating the subgroup: cells (IN,\n"
+              << "              OUT, RIGHT, LEFT, UP, DOWN, FRONT, BACK) for their turns,\n"
+              << "              GYRO, GYRO_OUTER, GYRO_MIDDLE, ROTATE (default: every\n"
+              << "              cell and GYRO). With slice gyros, turns and gyros count\n"
+              << "              only from slice configs they can be played from.\n"
+              << "  -p SIZES    piece sizes to look at, e.g. 4 for the 4c pieces alone\n"
+              << "              (default 1234)\n"
+              << "  -j THREADS  worker threads (default: all cores)\n"
+              << "  -M MB       memory per BFS level before it spills to disk (default 1024)\n"
+              << "  -V MB       largest visited bitmap to allocate, one bit per position\n"
+              << "              (default 16384)\n";
+}
+
+int main(int argc, char *argv[]) {
+    std::string moveNames = "IN,OUT,RIGHT,LEFT,UP,DOWN,FRONT,BACK,GYRO";
+    std::string sizes = "1234";
+    unsigned int threads = std::thread::hardware_concurrency();
+    unsigned long long memory = 1024;
+    unsigned long long maxVisited = 16384;
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        bool hasValue = i + 1 < argc;
+        if (arg == "-m" && hasValue) {
+            moveNames = argv[++i];
+        } else if (arg == "-p" && hasValue) {
+            sizes = argv[++i];
+        } else if (arg == "-j" && hasValue) {
+            threads = std::atoi(argv[++i]);
+        } else if (arg == "-M" && hasValue) {
+            memory = std::strtoull(argv[++i], NULL, 10);
+        } else if (arg == "-V" && hasValue) {
+            maxVisited = std::strtoull(argv[++i], NULL, 10);
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (threads == 0) threads = 1;
+
+    std::vector<MoveCode> moves;
+    std::stringstream names(moveNames);
+    std::string name;
+    while (std::getline(names, name, ',')) {
+        if (!addMoves(name, moves)) {
+            std::cerr << "Unknown move " << name << std::endl;
+            return 1;
+        }
+    }
+    // Moves that do the same as an earlier one only add work
+    moves = MoveAutomaton(moves).getMoves(MoveAutomaton::getStart());
+    bool trackConfigs = false;
+    for (size_t i = 0; i < moves.size(); i++) {
+        if (moves[i] >= MOVE_GYRO_OUTER && moves[i] < MOVE_ROTATE) trackConfigs = true;
+    }
+
+    // Stickers of other pieces are left where they are
+    std::vector<bool> tracked(NUM_STICKERS, false);
+    for (size_t i = 0; i < sizes.size(); i++) {
+        int size = sizes[i] - '0';
+        if (size < 1 || size > 4) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        std::vector<int> orbit = PuzzleState::getOrbit(size);
+        for (size_t j = 0; j < orbit.size(); j++) {
+            for (int k = 0; k < size; k++) {
+                tracked[PuzzleState::getSlotSticker(orbit[j]) + k] = true;
+            }
+        }
+    }
+
+    Enumeration job;
+    job.numConfigs = trackConfigs ? NUM_CONFIGS : 1;
+    job.legal.assign(job.numConfigs, std::vector<bool>(moves.size()));
+    job.nextConfig.assign(job.numConfigs, std::vector<int>(moves.size()));
+    for (size_t m = 0; m < moves.size(); m++) {
+        StickerPermutation perm;
+        const unsigned char *table = PuzzleState::getMovePermutation(moves[m]);
+        for (int i = 0; i < NUM_STICKERS; i++) {
+            perm[i] = tracked[i] ? table[i] : i;
+        }
+        job.perms.push_back(perm);
+        for (int config = 0; config < job.numConfigs; config++) {
+            // Turns and gyros needing slice gyros first are other moves
+            job.legal[config][m] = !trackConfigs || ((PuzzleState::getLegalMoves(config) >> moves[m]) & 1);
+            job.nextConfig[config][m] = trackConfigs ? PuzzleState::getNextConfig(config, moves[m]) : 0;
+        }
+    }
+
+    Scrambler group(job.perms);
+    job.group = &group;
+    unsigned long long order;
+    if (!group.getGroupOrder(order) || order > ~0ULL / job.numConfigs) {
+        std::cerr << "The subgroup has " << group.getGroupOrder() << " elements, too many to enumerate" << std::endl;
+        return 1;
+    }
+    unsigned long long numStates = order * job.numConfigs;
+    std::cout << "# moves " << moveNames << ", pieces " << sizes << "\n"
+              << "# " << order << " arrangements";
+    if (trackConfigs) std::cout << " in " << NUM_CONFIGS << " slice configs";
+    std::cout << std::endl;
+    if (numStates / 8 / 1024 / 1024 > maxVisited) {
+        std::cerr << "The visited bitmap would take " << numStates / 8 / 1024 / 1024 << " MB, more than -V" << std::endl;
+        return 1;
+    }
+    try {
+        job.visited.reset(new std::atomic<unsigned long long>[(numStates + 63) / 64]);
+    } catch (std::bad_alloc&) {
+        std::cerr << "Not enough memory for " << numStates << " visited bits" << std::endl;
+        return 1;
+    }
+    for (unsigned long long i = 0; i < (numStates + 63) / 64; i++) {
+        job.visited[i] = 0;
+    }
+
+    size_t memoryLimit = memory * 1024 * 1024 / sizeof(unsigned long long);
+    std::unique_ptr<Frontier> current(new Frontier(memoryLimit));
+    // The solved puzzle is element 0 in config 0
+    job.visited[0] = 1;
+    current->add(std::vector<unsigned long long>(1, 0));
+    job.failed = false;
+
+    std::vector<unsigned long long> counts;
+    auto start = std::chrono::steady_clock::now();
+    while (current->size() > 0) {
+        counts.push_back(current->size());
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cerr << "depth " << counts.size() - 1 << ": " << current->size() << " positions";
+        if (current->getSpilled()) std::cerr << ", " << current->getSpilled() << " on disk";
+        std::cerr << " (" << seconds << " s)" << std::endl;
+
+        std::unique_ptr<Frontier> next(new Frontier(memoryLimit));
+        current->rewind();
+        job.current = current.get();
+        job.next = next.get();
+        std::vector<std::thread> workers;
+        for (unsigned int i = 0; i < threads; i++) {
+            workers.push_back(std::thread(expand, &job));
+        }
+        for (size_t i = 0; i < workers.size(); i++) {
+            workers[i].join();
+        }
+        if (job.failed) {
+            std::cerr << "Could not write the frontier to disk" << std::endl;
+            return 1;
+        }
+        current.swap(next);
+    }
+
+    unsigned long long total = 0;
+    std::cout << "depth,positions\n";
+    for (size_t i = 0; i < counts.size(); i++) {
+        std::cout << i << "," << counts[i] << "\n";
+        total += counts[i];
+    }
+    std::cout << "# " << total << " positions, all within " << counts.size() - 1 << " moves" << std::endl;
+    return 0;
+}
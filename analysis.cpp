@@ -0,0 +1,82 @@
+/**************************************************************************
+ * 3to4++ - https://github.com/rayzchen/3to4++
+ *-------------------------------------------------------------------------
+ * Copyright 2024 Ray Chen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ **************************************************************************/
+
+
+#include "analysis.h"
+#include <algorithm>
+
+const double SolveAnalysis::pauseLimits[NUM_PAUSE_LIMITS] = {0.25, 0.5, 1.0, 2.0, 5.0};
+
+SolveAnalysis SolveAnalyser::analyse(const PuzzleState& start, const std::vector<MoveEntry>& moves, const std::vector<double>& times) {
+    SolveAnalysis analysis;
+    analysis.inputs = 0;
+    analysis.turns = 0;
+    analysis.duration = 0.0;
+    analysis.tps = 0.0;
+    std::fill(analysis.pauses, analysis.pauses + NUM_PAUSE_BUCKETS, 0);
+    analysis.medianPause = 0.0;
+    analysis.longestPause = 0.0;
+
+    PuzzleState state = start;
+    CellProgress progress(state);
+    int solved = progress.getSolvedCells();
+    std::vector<double> gaps;
+    double first = -1.0;
+    double last = -1.0;
+    int turns = 0;
+    for (size_t i = 0; i < moves.size(); i++) {
+        double time = times[i];
+        if (time >= 0.0 && (last < 0.0 || time - last >= ANALYSIS_INPUT_GAP)) {
+            if (last >= 0.0) gaps.push_back(time - last);
+            if (first < 0.0) first = time;
+            last = time;
+            analysis.inputs++;
+        }
+        if (moves[i].type == TURN) turns++;
+        MoveCode move = PuzzleState::getMoveCode(moves[i]);
+        if (move == NUM_MOVES) continue;
+        progress.applyMove(state, move);
+        // Only cells solved for the first time end a phase
+        int newlySolved = progress.getSolvedCells() & ~solved;
+        for (int cell = 0; cell < 8; cell++) {
+            if (!((newlySolved >> cell) & 1)) continue;
+            PhaseSplit split;
+            split.cell = cell;
+            split.turns = turns;
+            split.time = (first < 0.0 || last < 0.0) ? 0.0 : last - first;
+            analysis.phases.push_back(split);
+        }
+        solved |= newlySolved;
+    }
+
+    analysis.turns = turns;
+    if (first >= 0.0) analysis.duration = last - first;
+    if (analysis.duration > 0.0) analysis.tps = turns / analysis.duration;
+    for (size_t i = 0; i < gaps.size(); i++) {
+        int bucket = std::upper_bound(SolveAnalysis::pauseLimits, SolveAnalysis::pauseLimits + NUM_PAUSE_LIMITS, gaps[i]) -
+                     SolveAnalysis::pauseLimits;
+        analysis.pauses[bucket]++;
+        analysis.longestPause = std::max(analysis.longestPause, gaps[i]);
+    }
+    if (!gaps.empty()) {
+        std::nth_element(gaps.begin(), gaps.begin() + gaps.size() / 2, gaps.end());
+        analysis.medianPause = gaps[gaps.size() / 2];
+    }
+    return analysis;
+}
@@ -0,0 +1,68 @@
+/**************************************************************************
+ * 3to4++ - https://github.com/rayzchen/3to4++
+ *-------------------------------------------------------------------------
+ * Copyright 2024 Ray Chen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ **************************************************************************/
+
+
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include <vector>
+#include "state.h"
+
+// Pauses between inputs are counted in buckets up to these many seconds,
+// and a last bucket for longer ones
+#define NUM_PAUSE_LIMITS 5
+#define NUM_PAUSE_BUCKETS (NUM_PAUSE_LIMITS + 1)
+// Entries input closer together than this are parts of one input, like
+// the slice gyros the controller plays before a turn
+#define ANALYSIS_INPUT_GAP 0.001
+
+// A phase ends when a cell first shows a single color
+struct PhaseSplit {
+    int cell;
+    // Turns and seconds from the first input to the end of the phase
+    int turns;
+    double time;
+};
+
+struct SolveAnalysis {
+    // Timed inputs, turns among them and seconds from the first to the last
+    size_t inputs;
+    int turns;
+    double duration;
+    double tps;
+    size_t pauses[NUM_PAUSE_BUCKETS];
+    double medianPause;
+    double longestPause;
+    // In the order the cells were solved, leaving out cells that started
+    // solved
+    std::vector<PhaseSplit> phases;
+
+    static const double pauseLimits[NUM_PAUSE_LIMITS];
+};
+
+// Works out the pace of a solve from the input time of each move
+class SolveAnalyser {
+    public:
+        // Moves are played from start, each with the seconds it was input
+        // at on a monotonic clock, negative for moves that were not input,
+        // such as ones loaded from a file. Those are played but not timed.
+        static SolveAnalysis analyse(const PuzzleState& start, const std::vector<MoveEntry>& moves, const std::vector<double>& times);
+};
+
+#endif // analysis.h
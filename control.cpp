@@ -24,10 +24,10 @@
 #include <random>
 #include <map>
 #include <sstream>
+#include <iomanip>
+#include <ctime>
 #include <fstream>
 #include <iostream>
-#define RYML_SINGLE_HDR_DEFINE_NOW
-#include <rapidyaml-0.6.0.hpp>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -57,91 +57,168 @@ int PuzzleController::cellKeys[] = {GLFW_KEY_D, GLFW_KEY_V, GLFW_KEY_F, GLFW_KEY
                                     GLFW_KEY_E, GLFW_KEY_C, GLFW_KEY_S, GLFW_KEY_R};
 int PuzzleController::directionKeys[] = {GLFW_KEY_I, GLFW_KEY_K, GLFW_KEY_J,
                                          GLFW_KEY_L, GLFW_KEY_O, GLFW_KEY_U};
+// Same length as a single LEFT or RIGHT gyro
+float PuzzleController::gyroLength = 4.0f;
+// Seconds a hint may search for, short enough to feel instant
+double PuzzleController::hintBudget = 0.05;
+
+// Prep moves and the move itself, looked up for the puzzle's slice config.
+// Empty for moves the puzzle has no code for.
+static const std::vector<MoveEntry>& getMacro(const Puzzle& puzzle, MoveEntry entry) {
+    static const std::vector<MoveEntry> none;
+    MoveCode move = PuzzleState::getMoveCode(entry);
+    if (move == NUM_MOVES) return none;
+    return PuzzleState::getMacro(PuzzleState::getConfig(puzzle), move);
+}
+
+static bool isLegal(const Puzzle& puzzle, MoveEntry entry) {
+    MoveCode move = PuzzleState::getMoveCode(entry);
+    if (move == NUM_MOVES) return false;
+    return (PuzzleState::getLegalMoves(PuzzleState::getConfig(puzzle)) >> move) & 1;
+}
+
+// Cell and direction as named in the help text
+static std::string getMoveName(MoveEntry entry) {
+    static const char *cells[] = {"I", "O", "R", "L", "U", "D", "F", "B"};
+    static const char *directions[] = {"x", "x'", "y", "y'", "z", "z'"};
+    std::string name = cells[entry.cell];
+    if (entry.type == GYRO) return name + " gyro";
+    return name + " " + directions[entry.direction];
+}
+
+#define JOURNAL_FILE "autosave.journal"
+#define STATS_FILE "solves.txt"
+// Search nodes the Solve action spends looking for a shortest solution,
+// about a second, which finds one only close to solved
+#define SOLVE_SEARCH_NODES 1000000
+
+static unsigned long long getJournalTime() {
+    return glfwGetTime() * 1000.0;
+}
 
 PuzzleController::PuzzleController(PuzzleRenderer* renderer) {
 	this->renderer = renderer;
 	this->puzzle = renderer->puzzle;
+    queuedPuzzle = new Puzzle(*puzzle);
     history = new MoveHistory();
     std::random_device rd;
     rng.seed(rd());
-    scrambleIndex = -1;
-
-    std::ifstream file("scramble.txt");
-    if (file.is_open()) {
-        file >> std::ws;
-        std::vector<std::array<int, 2>> moves;
-        std::array<int, 2> move;
-        char comma;
-        while (true) {
-            file >> move[0] >> comma >> move[1];
-            if (file.eof()) {
-                break;
-            }
-            if (comma == ',') {
-                moves.push_back(move);
-            }
-        }
-        for (size_t i = 0; i < moves.size(); i++) {
-            CellLocation cell = (CellLocation)moves[i][0];
-            if (moves[i][1] == -1) {
-                startGyro(cell);
-            } else {
-                startCellMove(cell, (RotateDirection)moves[i][1]);
-            }
-            while (renderer->pendingMoves.size()) {
-                MoveEntry entry = renderer->pendingMoves.front();
-                renderer->pendingMoves.pop();
-                performMove(entry);
-                scramble.push_back(entry);
-            }
-        }
-        renderer->animating = false;
-        getScrambleTwists();
-    }
+    scrambleMoves = 0;
+    scrambler = NULL;
+    scramblingState = false;
+    stateSeed = 0;
+    animateScramble = false;
+    puzzleChanged = false;
+    solver = NULL;
+    solving = false;
+    solveCancelled = false;
+    solveOptimal = false;
+    solved = false;
+    solveBest = -1;
+    sampleNodes = 0;
+    sampleTime = 0.0;
+    nodeRate = 0.0;
+    hints = NULL;
+    hintGoal.type = HINT_SOLVE;
+    hintGoal.target = 0;
+    historyRestart = true;
+    sessionRestart = true;
+    timerArmed = false;
+    timerRunning = false;
+    timerStart = 0.0;
+
+    // Every scramble in scramble.txt can be loaded, the first one at once
+    // unless the last run is recovered instead
+    scrambles.open("scramble.txt");
+    bool recovered = recoverJournal();
+#ifndef __EMSCRIPTEN__
+    if (journal.open(JOURNAL_FILE)) history->setJournal(&journal);
+    stats.open(STATS_FILE);
+#endif
+    if (!recovered && scrambles.hasScramble(0)) loadScramble(0);
 }
 
 PuzzleController::~PuzzleController() {
+    cancelSolve();
+    if (solveThread.joinable()) solveThread.join();
+    delete this->solver;
+    delete this->hints;
     delete this->history;
+    delete this->queuedPuzzle;
+    delete this->scrambler;
 }
 
-void PuzzleController::performMove(MoveEntry entry) {
-    switch (entry.type) {
-        case TURN: puzzle->rotateCell(entry.cell, entry.direction); break;
-        case ROTATE: puzzle->rotatePuzzle(entry.direction); break;
-        case GYRO: puzzle->gyroCell(entry.cell); break;
-        case GYRO_OUTER: puzzle->gyroOuterSlice(); break;
-        case GYRO_MIDDLE: puzzle->gyroMiddleSlice(entry.location); break;
+void PuzzleController::scheduleMove(MoveEntry entry) {
+    if (timerArmed && !timerRunning) {
+        timerRunning = true;
+        timerStart = glfwGetTime();
     }
+    queuedPuzzle->applyMove(entry);
+    renderer->scheduleMove(entry);
+}
+
+void PuzzleController::scheduleSequence(std::vector<MoveEntry> entries, float maxLength) {
+    if (timerArmed && !timerRunning) {
+        timerRunning = true;
+        timerStart = glfwGetTime();
+    }
+    for (size_t i = 0; i < entries.size(); i++) {
+        queuedPuzzle->applyMove(entries[i]);
+    }
+    renderer->scheduleSequence(entries, maxLength);
+}
+
+void PuzzleController::performMove(MoveEntry entry) {
+    puzzle->applyMove(entry);
 }
 
 bool PuzzleController::updatePuzzle(GLFWwindow *window, double dt) {
 	MoveEntry entry;
-    bool updated = false;
-	if (renderer->updateAnimations(window, dt, &entry)) {
-        performMove(entry);
-        if (scrambleIndex != -1) {
-            if (renderer->pendingMoves.size() == 0) {
-                scrambleIndex++;
-                performScramble();
-            }
+    double time;
+    bool updated = puzzleChanged;
+    puzzleChanged = false;
+    double step = dt;
+    // Several moves can finish on the same frame when animated together
+	while (renderer->updateAnimations(window, step, &entry, &time)) {
+        step = 0.0;
+        if (scrambleMoves > 0) {
+            performMove(entry);
+            scrambleMoves--;
+            if (scrambleMoves == 0) renderer->animationSpeed = savedAnimationSpeed;
         } else {
-            history->insertMove(entry);
+            // The puzzle has not taken the move yet, so it is where the
+            // history starts
+            if (historyRestart) history->reset(PuzzleState(*puzzle));
+            historyRestart = false;
+            writeSessionMove(entry);
+            performMove(entry);
+            history->insertMove(entry, time);
+            if (timerRunning && PuzzleState(*puzzle).isSolved()) stopTimer(time);
         }
         updated = true;
 	}
-    return updated || renderer->animating;
+    if (solveThread.joinable() && !solving) {
+        solveThread.join();
+        if (scramblingState) {
+            finishRandomState();
+        } else {
+            finishSolve();
+        }
+        updated = true;
+    }
+    // Keep drawing while solving so the progress and time stay live
+    return updated || renderer->animating || solving || timerRunning;
 }
 
 bool PuzzleController::checkMiddleGyro(int key, bool flip) {
     if (key == GLFW_KEY_M || key == GLFW_KEY_PERIOD) {
         int direction = (key == GLFW_KEY_M) ? -1 : 1;
         if (flip) direction *= -1;
-        if (puzzle->canGyroMiddle(direction)) {
-            MoveEntry entry;
-            entry.type = GYRO_MIDDLE;
-            entry.animLength = 1.0f;
-            entry.location = direction;
-            renderer->scheduleMove(entry);
+        MoveEntry entry;
+        entry.type = GYRO_MIDDLE;
+        entry.location = direction;
+        if (isLegal(*queuedPuzzle, entry)) {
+            scheduleMove(getMacro(*queuedPuzzle, entry)[0]);
             return true;
         }
     } else if (key == GLFW_KEY_COMMA) {
@@ -149,7 +226,7 @@ bool PuzzleController::checkMiddleGyro(int key, bool flip) {
         entry.type = GYRO_MIDDLE;
         entry.animLength = 1.0f;
         entry.location = 0;
-        renderer->scheduleMove(entry);
+        scheduleMove(entry);
         return true;
     }
     return false;
@@ -198,19 +275,22 @@ bool PuzzleController::checkDirectionalMove(GLFWwindow* window, int key, bool fl
         }
 
         if (checkDirectionKey(key, &direction, flip)) {
-            if (puzzle->canRotateCell(cell, direction)) {
+            MoveEntry entry;
+            entry.type = TURN;
+            entry.cell = cell;
+            entry.direction = direction;
+            if (getMacro(*queuedPuzzle, entry).size()) {
                 startCellMove(cell, direction);
                 return true;
             }
         }
     } else if (checkDirectionKey(key, &direction, flip)) {
-        if (puzzle->canRotatePuzzle(direction)) {
-            // whole puzzle rotation
-            MoveEntry entry;
-            entry.type = ROTATE;
-            entry.animLength = 1.0f;
-            entry.direction = direction;
-            renderer->scheduleMove(entry);
+        // whole puzzle rotation
+        MoveEntry entry;
+        entry.type = ROTATE;
+        entry.direction = direction;
+        if (isLegal(*queuedPuzzle, entry)) {
+            scheduleMove(getMacro(*queuedPuzzle, entry)[0]);
             return true;
         }
     }
@@ -218,122 +298,28 @@ bool PuzzleController::checkDirectionalMove(GLFWwindow* window, int key, bool fl
 }
 
 void PuzzleController::startGyro(CellLocation cell) {
+    // Prep moves and the gyro itself play back to back, sped up to take as
+    // long as a gyro without prep moves
     MoveEntry entry;
-    int direction = 0;
-    switch (cell) {
-        case LEFT:
-        case RIGHT:
-            entry.type = GYRO;
-            entry.animLength = 4.0f;
-            entry.cell = cell;
-            renderer->scheduleMove(entry);
-            break;
-        case UP:
-        case DOWN:
-            if (puzzle->middleSliceDir == FRONT) {
-                entry.type = GYRO_MIDDLE;
-                entry.animLength = 1.0f;
-                entry.location = 0;
-                renderer->scheduleMove(entry);
-            }
-
-            if (puzzle->middleSlicePos == 0) {
-                direction = puzzle->outerSlicePos;
-            } else if (puzzle->middleSlicePos == 2 * puzzle->outerSlicePos) {
-                direction = -puzzle->outerSlicePos;
-            } else if (puzzle->middleSlicePos == -puzzle->outerSlicePos) {
-                entry.type = GYRO_OUTER;
-                entry.animLength = 2.0f;
-                entry.location = -1 * puzzle->outerSlicePos;
-                renderer->scheduleMove(entry);
-                direction = 0;
-            } else if (puzzle->middleSlicePos == puzzle->outerSlicePos) {
-                direction = 0;
-            }
-
-            if (direction != 0) {
-                entry.type = GYRO_MIDDLE;
-                entry.animLength = 1.0f;
-                entry.location = direction;
-                renderer->scheduleMove(entry);
-            }
-
-            entry.type = GYRO;
-            entry.animLength = 3.0f;
-            entry.cell = cell;
-            renderer->scheduleMove(entry);
-            break;
-        case FRONT:
-        case BACK:
-            if (puzzle->middleSliceDir == UP) {
-                entry.type = GYRO_MIDDLE;
-                entry.animLength = 1.0f;
-                entry.location = 0;
-                renderer->scheduleMove(entry);
-            }
-
-            if (puzzle->middleSlicePos == 0) {
-                direction = puzzle->outerSlicePos;
-            } else if (puzzle->middleSlicePos == 2 * puzzle->outerSlicePos) {
-                direction = -puzzle->outerSlicePos;
-            } else if (puzzle->middleSlicePos == -puzzle->outerSlicePos) {
-                entry.type = GYRO_OUTER;
-                entry.animLength = 2.0f;
-                entry.location = -1 * puzzle->outerSlicePos;
-                renderer->scheduleMove(entry);
-                direction = 0;
-            } else if (puzzle->middleSlicePos == puzzle->outerSlicePos) {
-                direction = 0;
-            }
-
-            if (direction != 0) {
-                entry.type = GYRO_MIDDLE;
-                entry.animLength = 1.0f;
-                entry.location = direction;
-                renderer->scheduleMove(entry);
-            }
-
-            entry.type = GYRO;
-            entry.animLength = 3.0f;
-            entry.cell = cell;
-            renderer->scheduleMove(entry);
-            break;
-        case IN:
-        case OUT:
-            return;
-    }
+    entry.type = GYRO;
+    entry.cell = cell;
+    const std::vector<MoveEntry>& macro = getMacro(*queuedPuzzle, entry);
+    if (macro.size()) scheduleSequence(macro, gyroLength);
 }
 
 void PuzzleController::startCellMove(CellLocation cell, RotateDirection direction) {
     MoveEntry entry;
-    if ((cell == UP || cell == DOWN) && puzzle->middleSliceDir == FRONT) {
-        entry.type = GYRO_MIDDLE;
-        entry.animLength = 1.0f;
-        entry.location = 0;
-        renderer->scheduleMove(entry);
-    } else if ((cell == FRONT || cell == BACK) && puzzle->middleSliceDir == UP) {
-        entry.type = GYRO_MIDDLE;
-        entry.animLength = 1.0f;
-        entry.location = 0;
-        renderer->scheduleMove(entry);
-    }
-
-    float length;
-    if (cell == UP || cell == DOWN || cell == FRONT || cell == BACK) {
-        length = 2.0f;
-    } else {
-        length = 1.0f;
-    }
-
     entry.type = TURN;
-    entry.animLength = length;
     entry.cell = cell;
     entry.direction = direction;
-    renderer->scheduleMove(entry);
+    const std::vector<MoveEntry>& moves = getMacro(*queuedPuzzle, entry);
+    for (size_t i = 0; i < moves.size(); i++) {
+        scheduleMove(moves[i]);
+    }
 }
 
 void PuzzleController::keyCallback(GLFWwindow* window, int key, int action, int mods, bool flip) {
-    if (renderer->animating) return;
+    if (scrambleMoves > 0) return;
     if (action == GLFW_PRESS) {
         status.clear();
         if (mods == 0) {
@@ -345,8 +331,8 @@ void PuzzleController::keyCallback(GLFWwindow* window, int key, int action, int
                 MoveEntry entry;
                 entry.type = GYRO_OUTER;
                 entry.animLength = 2.0f;
-                entry.location = -1 * puzzle->outerSlicePos;
-                renderer->scheduleMove(entry);
+                entry.location = -1 * queuedPuzzle->outerSlicePos;
+                scheduleMove(entry);
             } else if (key == GLFW_KEY_Z) {
                 undoMove();
             } else if (key == GLFW_KEY_Y) {
@@ -357,16 +343,28 @@ void PuzzleController::keyCallback(GLFWwindow* window, int key, int action, int
 }
 
 void PuzzleController::resetPuzzle() {
+    renderer->clearMoves();
+    if (scrambleMoves > 0) {
+        renderer->animationSpeed = savedAnimationSpeed;
+        scrambleMoves = 0;
+    }
     puzzle->resetPuzzle();
+    *queuedPuzzle = *puzzle;
     scramble.clear();
     history->reset();
+    historyRestart = true;
+    sessionRestart = true;
+    timerArmed = false;
+    timerRunning = false;
     status = "Reset puzzle!";
 }
 
 void PuzzleController::undoMove() {
+    // History only knows about committed moves
+    if (renderer->animating) return;
     MoveEntry entry;
     if (history->undoMove(&entry)) {
-        renderer->scheduleMove(entry);
+        scheduleMove(entry);
         status = "Undid 1 move!";
     } else {
         status = "Error: nothing to undo!";
@@ -374,274 +372,818 @@ void PuzzleController::undoMove() {
 }
 
 void PuzzleController::redoMove() {
+    if (renderer->animating) return;
     MoveEntry entry;
     if (history->redoMove(&entry)) {
-        renderer->scheduleMove(entry);
+        scheduleMove(entry);
         status = "Redid 1 move!";
     } else {
         status = "Error: nothing to redo!";
     }
 }
 
-void rotate4in8(std::array<int, 8>& cells, std::array<int, 4> indices) {
-    int temp = cells[indices[0]];
-    for (int i = 0; i < 3; i++) {
-        cells[indices[i]] = cells[indices[i + 1]];
+void PuzzleController::scramblePuzzle(int scrambleLength) {
+    // Starts from solved, with the history and session starting over
+    resetPuzzle();
+    scramble = Scrambler::randomMoves(scrambleLength, rng);
+    getScrambleTwists();
+    performScramble();
+    armTimer();
+    status = "Scrambled puzzle!";
+}
+
+void PuzzleController::loadScramble(size_t index) {
+    if (!scrambles.hasScramble(index)) {
+        status = "Error: scramble.txt has no such scramble!";
+        return;
+    }
+    std::vector<MoveEntry> moves;
+    size_t errorOffset;
+    if (!scrambles.getScramble(index, moves, errorOffset)) {
+        std::ostringstream errorStatus;
+        errorStatus << "Error: invalid move at character " << errorOffset + 1 << " of scramble.txt!";
+        status = errorStatus.str();
+        return;
+    }
+    resetPuzzle();
+    // Played on the puzzle core, the renderer only sees where it ends up
+    PuzzleState state(*puzzle);
+    for (size_t i = 0; i < moves.size(); i++) {
+        const std::vector<MoveEntry>& macro = PuzzleState::getMacro(state.config, PuzzleState::getMoveCode(moves[i]));
+        for (size_t j = 0; j < macro.size(); j++) {
+            state.applyMove(PuzzleState::getMoveCode(macro[j]));
+            scramble.push_back(macro[j]);
+        }
     }
-    cells[indices[3]] = temp;
+    state.toPuzzle(*puzzle);
+    *queuedPuzzle = *puzzle;
+    puzzleChanged = true;
+    getScrambleTwists();
+    armTimer();
+    std::ostringstream loadStatus;
+    loadStatus << "Loaded scramble " << index + 1;
+    if (scrambles.isIndexed()) loadStatus << " of " << scrambles.getNumScrambles();
+    loadStatus << " from scramble.txt!";
+    status = loadStatus.str();
+}
+
+bool PuzzleController::hasScrambles() {
+    return scrambles.hasScramble(0);
+}
+
+size_t PuzzleController::getNumScrambles() {
+    return scrambles.isIndexed() ? scrambles.getNumScrambles() : 0;
 }
 
-void rotate8bycell(std::array<int, 8>& cells, CellLocation cell) {
-    if (cell == RIGHT) {
-        rotate4in8(cells, {0, 6, 1, 7});
-    } else if (cell == LEFT) {
-        rotate4in8(cells, {1, 6, 0, 7});
-    } else if (cell == UP) {
-        rotate4in8(cells, {2, 6, 3, 7});
-    } else if (cell == DOWN) {
-        rotate4in8(cells, {3, 6, 2, 7});
-    } else if (cell == FRONT) {
-        rotate4in8(cells, {4, 6, 5, 7});
-    } else if (cell == BACK) {
-        rotate4in8(cells, {5, 6, 4, 7});
+void PuzzleController::scrambleRandomState() {
+    // Built on the solve thread, which a solve may be using
+    if (solving) {
+        status = "Error: wait for the solve to finish!";
+        return;
     }
+#ifndef __EMSCRIPTEN__
+    if (solveThread.joinable()) solveThread.join();
+#endif
+    // The random number generator stays on this thread
+    stateSeed = rng();
+    scramblingState = true;
+    solveCancelled = false;
+    solving = true;
+#ifdef __EMSCRIPTEN__
+    runRandomState();
+    finishRandomState();
+#else
+    solveThread = std::thread(&PuzzleController::runRandomState, this);
+#endif
 }
 
-void PuzzleController::scramblePuzzle(int scrambleLength) {
-    static std::discrete_distribution<int> typeDist({2, 3});
-    static std::uniform_int_distribution<int> directionDist(0, 5);
-    static std::discrete_distribution<int> cellDist({2, 2, 6, 6, 1, 1, 1, 1});
-    // FBUD only for visual effect, functionally unneeded
-    static std::uniform_int_distribution<int> boolDist(0, 1);
-    MoveEntry entry;
-    entry.type = TURN;
-    if (scrambleLength == 0) {
-        scrambleLength = 45;
-    }
-    CellLocation lastCell = (CellLocation)-1;
-    for (int i = 0; i < scrambleLength; i++) {
-        if (typeDist(rng) == 0 && entry.type != GYRO) {
-            // don't include gyros in scramble length
-            i--;
-            entry.type = GYRO;
-            entry.cell = (CellLocation)(2 + directionDist(rng));
-        } else {
-            entry.type = TURN;
-            while (true) {
-                entry.cell = (CellLocation)cellDist(rng);
-                if (entry.cell != lastCell) break;
-                if (entry.cell == LEFT || entry.cell == RIGHT) break;
-            }
-            lastCell = entry.cell;
-            switch (entry.cell) {
-                case IN:
-                case OUT:
-                    // YZ or ZY
-                    entry.direction = (RotateDirection)boolDist(rng);
-                    break;
-                case UP:
-                case DOWN:
-                    // XZ or ZX
-                    entry.direction = (RotateDirection)(2 + boolDist(rng));
-                    break;
-                case FRONT:
-                case BACK:
-                    // XY or YX
-                    entry.direction = (RotateDirection)(4 + boolDist(rng));
-                    break;
-                case LEFT:
-                case RIGHT:
-                    // any
-                    entry.direction = (RotateDirection)directionDist(rng);
-                    break;
-            }
-        }
-        scramble.push_back(entry);
+void PuzzleController::runRandomState() {
+    if (scrambler == NULL) scrambler = new Scrambler();
+    std::mt19937 stateRng(stateSeed);
+    randomStart = scrambler->randomState(stateRng);
+    solving = false;
+}
+
+void PuzzleController::finishRandomState() {
+    scramblingState = false;
+    if (solveCancelled) {
+        status = "Scramble cancelled!";
+        return;
     }
+    // Starts from solved, with the history and session starting over. The
+    // only moves known to reach the state are thousands long, so the state
+    // is set without a scramble.
+    resetPuzzle();
+    randomStart.toPuzzle(*puzzle);
+    *queuedPuzzle = *puzzle;
+    puzzleChanged = true;
+    std::cout << "state: " << randomStart.encode() << std::endl;
+    armTimer();
+    status = "Scrambled to a random state!";
+}
 
-    bool reorient = false;
-    if (reorient) {
-        // R, L, U, D, F, B, O, I
-        // Reorient to HSC default orientation
-        std::array<int, 8> cells = {0, 1, 4, 5, 3, 2, 6, 7};
+void PuzzleController::performScramble() {
+    if (!animateScramble && !renderer->animating) {
+        // Apply straight to the puzzle and let the next frame show the result
         for (size_t i = 0; i < scramble.size(); i++) {
-            if (scramble[i].type == GYRO) {
-                rotate8bycell(cells, scramble[i].cell);
+            const std::vector<MoveEntry>& moves = getMacro(*puzzle, scramble[i]);
+            for (size_t j = 0; j < moves.size(); j++) {
+                performMove(moves[j]);
             }
         }
-        entry.type = GYRO;
-        std::array<int, 3> colorsToFix = {4, 2, 7};
-        for (int i = 0; i < 3; i++) {
-            int index = std::distance(cells.begin(), std::find(cells.begin(), cells.end(), colorsToFix[i]));
-            if (index != colorsToFix[i]) {
-                // Move to I
-                if (index == 6) {
-                    entry.cell = LEFT;
-                    scramble.push_back(entry);
-                    scramble.push_back(entry);
-                    rotate8bycell(cells, entry.cell);
-                    rotate8bycell(cells, entry.cell);
-                } else if (index < 6) {
-                    entry.cell = (CellLocation)(2 + index);
-                    scramble.push_back(entry);
-                    rotate8bycell(cells, entry.cell);
-                }
-                // Move to desired location (gyro opposite)
-                if (colorsToFix[i] != 7) {
-                    // Don't gyro if inner
-                    entry.cell = (CellLocation)(2 + colorsToFix[i] + 1);
-                    scramble.push_back(entry);
-                    rotate8bycell(cells, entry.cell);
-                }
-            }
+        *queuedPuzzle = *puzzle;
+        puzzleChanged = true;
+        return;
+    }
+    savedAnimationSpeed = renderer->animationSpeed;
+    renderer->animationSpeed = 40.0f;
+    size_t queued = renderer->pendingMoves.size();
+    for (size_t i = 0; i < scramble.size(); i++) {
+        if (scramble[i].type == GYRO) {
+            startGyro(scramble[i].cell);
+        } else {
+            startCellMove(scramble[i].cell, scramble[i].direction);
         }
     }
+    scrambleMoves = renderer->pendingMoves.size() - queued;
+}
 
-    getScrambleTwists();
-    scrambleIndex = 0;
-    performScramble();
-    status = "Scrambled puzzle!";
+void PuzzleController::getScrambleTwists() {
+    std::cout << "scramble: >\n  " << Scrambler::getHscScramble(scramble) << std::endl;
+    std::cout << "phys_scramble: >\n  " << Scrambler::getPhysScramble(scramble) << std::endl;
 }
 
-void PuzzleController::performScramble() {
-    static float origRenderSpeed;
-    if (scrambleIndex == 0) {
-        origRenderSpeed = renderer->animationSpeed;
-        renderer->animationSpeed = 40.0f;
-    }
-    if ((size_t)scrambleIndex == scramble.size()) {
-        scrambleIndex = -1;
-        renderer->animationSpeed = origRenderSpeed;
-    } else {
-        if (scramble[scrambleIndex].type == GYRO) {
-            startGyro(scramble[scrambleIndex].cell);
-        } else {
-            startCellMove(scramble[scrambleIndex].cell, scramble[scrambleIndex].direction);
+void PuzzleController::openFile(std::string filename) {
+    if (SessionReader::isSessionFile(filename)) {
+        openSession(filename);
+        return;
+    }
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        status = "Error: could not open " + filename + "!";
+        return;
+    }
+    file.seekg(0, std::ios::end);
+    std::string buffer((size_t)file.tellg(), '\0');
+    file.seekg(0, std::ios::beg);
+    file.read(&buffer[0], buffer.size());
+
+    // Algorithms fail on the first key of a log, so they are tried first
+    std::vector<MoveCode> algorithm;
+    size_t errorOffset;
+    std::string error;
+    bool isAlgorithm = Notation::parse(buffer.data(), buffer.size(), algorithm, errorOffset, error);
+    if (isAlgorithm && !algorithm.empty()) {
+        openAlgorithm(filename, algorithm);
+        return;
+    }
+
+    // Reading changes the buffer, so Hyperspeedcube logs get a copy
+    std::string hscBuffer = buffer;
+    MoveLog log;
+    HscLog hscLog;
+    if (!log.read(buffer)) {
+        if (!hscLog.read(hscBuffer)) {
+            if (!isAlgorithm && errorOffset > 0) {
+                // Got through some moves, so it was meant as an algorithm
+                std::ostringstream errorStatus;
+                errorStatus << "Error: " << error << " at character " << errorOffset + 1 << " of " << filename << "!";
+                status = errorStatus.str();
+            } else {
+                status = "Error: " + filename + " is not a valid log file!";
+            }
+            return;
         }
+        if (!log.fromHsc(hscLog)) {
+            status = "Error: " + filename + " has twists the physical puzzle cannot make!";
+            return;
+        }
+    }
+
+    resetPuzzle();
+    scramble = log.scramble;
+    size_t position = log.moves.size();
+    std::vector<MoveEntry>& moves = log.moves;
+    moves.insert(moves.end(), log.redo.begin(), log.redo.end());
+    history->setMoves(moves, position, log.start);
+    position = history->getPosition();
+    history->getState(position).toPuzzle(*puzzle);
+    *queuedPuzzle = *puzzle;
+    puzzleChanged = true;
+    historyRestart = false;
+    std::ostringstream loadStatus;
+    loadStatus << "Loaded " << position << " moves from " << filename << "!";
+    status = loadStatus.str();
+}
+
+void PuzzleController::openAlgorithm(std::string filename, const std::vector<MoveCode>& algorithm) {
+    PuzzleState start;
+    PuzzleState state = start;
+    std::vector<MoveEntry> moves;
+    size_t played = Notation::toEntries(algorithm, state, moves);
+    if (played < algorithm.size()) {
+        std::ostringstream errorStatus;
+        errorStatus << "Error: move " << played + 1 << " of " << filename << " cannot be played from there!";
+        status = errorStatus.str();
+        return;
     }
+    resetPuzzle();
+    history->setMoves(moves, moves.size(), start);
+    state.toPuzzle(*puzzle);
+    *queuedPuzzle = *puzzle;
+    puzzleChanged = true;
+    historyRestart = false;
+    std::ostringstream loadStatus;
+    loadStatus << "Loaded " << algorithm.size() << " moves from " << filename << "!";
+    status = loadStatus.str();
 }
 
-void PuzzleController::getScrambleTwists() {
-    std::map<CellLocation, std::pair<int, int>> gyroMoves = {
-        {RIGHT, {2, 4}}, // U cell turns F
-        {LEFT, {2, 5}}, // U cell turns B
-        {UP, {4, 0}}, // F cell turns R
-        {DOWN, {4, 1}}, // F cell turns L
-        {FRONT, {2, 1}}, // U cell turns R
-        {BACK, {2, 0}} // U cell turns L
-    };
-    std::ostringstream hscScramble;
-    hscScramble << 0 << "," << 0 << "," << 7 << " ";
-    for (size_t i = 0; i < scramble.size(); i++) {
-        if (scramble[i].type == GYRO) {
-            hscScramble << gyroMoves[scramble[i].cell].first << "," << gyroMoves[scramble[i].cell].second;
-            hscScramble << "," << 7 << " ";
+void PuzzleController::playAlgorithm(const std::string& text) {
+    std::vector<MoveCode> algorithm;
+    size_t errorOffset;
+    std::string error;
+    if (!Notation::parse(text.data(), text.size(), algorithm, errorOffset, error)) {
+        std::ostringstream errorStatus;
+        errorStatus << "Error: " << error << " at character " << errorOffset + 1 << "!";
+        status = errorStatus.str();
+        return;
+    }
+    PuzzleState state(*queuedPuzzle);
+    PuzzleState end = state;
+    size_t played = Notation::apply(algorithm, end);
+    if (played < algorithm.size()) {
+        std::ostringstream errorStatus;
+        errorStatus << "Error: move " << played + 1 << " cannot be played from there!";
+        status = errorStatus.str();
+        return;
+    }
+    // Gyros play with their slice gyros sped up, like from the keys
+    int config = state.config;
+    for (size_t i = 0; i < algorithm.size(); i++) {
+        const std::vector<MoveEntry>& macro = PuzzleState::getMacro(config, algorithm[i]);
+        if (algorithm[i] >= MOVE_GYRO && algorithm[i] < MOVE_GYRO_OUTER) {
+            scheduleSequence(macro, gyroLength);
         } else {
-            int cell, direction;
-            if (scramble[i].cell == IN) {
-                cell = 7;
-            } else if (scramble[i].cell == OUT) {
-                cell = 6;
-            } else {
-                cell = (int)scramble[i].cell - 2;
+            for (size_t j = 0; j < macro.size(); j++) {
+                scheduleMove(macro[j]);
             }
-            direction = (int)scramble[i].direction;
-            if (cell >= 2 && cell < 6) direction += 6;
-            hscScramble << cell << "," << direction << "," << 1 << " ";
         }
+        config = PuzzleState::getNextConfig(config, algorithm[i]);
     }
+    std::ostringstream playStatus;
+    playStatus << "Playing " << algorithm.size() << " moves!";
+    status = playStatus.str();
+}
 
-    std::ostringstream physScramble;
-    for (size_t i = 0; i < scramble.size(); i++) {
-        if (scramble[i].type == GYRO) {
-            physScramble << (int)scramble[i].cell << "," << -1 << " ";
+bool PuzzleController::recoverJournal() {
+#ifdef __EMSCRIPTEN__
+    return false;
+#else
+    PuzzleState start;
+    std::vector<JournalRecord> records;
+    if (!Journal::read(JOURNAL_FILE, start, records)) return false;
+    // Nothing worth keeping after a reset
+    if (records.empty() && start.isSolved()) return false;
+    history->reset(start);
+    for (size_t i = 0; i < records.size(); i++) {
+        if (records[i].type == SESSION_SEEK) {
+            history->seek(records[i].value);
         } else {
-            physScramble << scramble[i].cell << "," << (int)scramble[i].direction << " ";
+            history->insertMove(SessionReader::getSessionEntry(records[i].type), -1.0);
         }
     }
-    std::cout << "scramble: >\n  " << hscScramble.str() << std::endl;
-    std::cout << "phys_scramble: >\n  " << physScramble.str() << std::endl;
+    history->getState(history->getPosition()).toPuzzle(*puzzle);
+    *queuedPuzzle = *puzzle;
+    puzzleChanged = true;
+    historyRestart = false;
+    std::ostringstream recoverStatus;
+    recoverStatus << "Recovered " << history->getPosition() << " moves from the last run";
+    if (scrambles.hasScramble(0)) recoverStatus << " instead of loading scramble.txt";
+    recoverStatus << "!";
+    status = recoverStatus.str();
+    return true;
+#endif
 }
 
-void PuzzleController::openFile(std::string filename) {
+void PuzzleController::openSession(std::string filename) {
+    SessionReader reader;
+    if (!reader.open(filename) || !reader.hasSession()) {
+        status = "Error: " + filename + " is not a valid session file!";
+        return;
+    }
+    resetPuzzle();
+    // The last checkpoint gives the puzzle, so only the entries are read
+    reader.getState(reader.getNumMoves()).toPuzzle(*puzzle);
+    *queuedPuzzle = *puzzle;
+    puzzleChanged = true;
+    // Undos in the session fold back into redo moves as they are replayed
+    history->reset(reader.getState(0));
+    for (size_t i = 0; i < reader.getNumMoves(); i++) {
+        history->insertMove(reader.getMove(i), -1.0);
+    }
+    historyRestart = false;
     std::ostringstream loadStatus;
-    loadStatus << "Loaded log file from " << filename;
+    loadStatus << "Loaded " << reader.getNumMoves() << " moves from " << filename << "!";
     status = loadStatus.str();
 }
 
+void PuzzleController::recordSession(std::string filename) {
+    if (!session.open(filename)) {
+        status = "Error: could not record to " + filename + "!";
+        return;
+    }
+    sessionRestart = true;
+    status = "Recording session to " + filename + "!";
+}
+
+void PuzzleController::stopRecording() {
+    session.close();
+    status = "Stopped recording!";
+}
+
+bool PuzzleController::isRecording() {
+    return session.isOpen();
+}
+
+void PuzzleController::writeSessionMove(MoveEntry entry) {
+    if (!session.isOpen()) return;
+    unsigned long long time = glfwGetTime() * 1000.0;
+    // The puzzle has not taken the move yet, so it is where the session starts
+    if (sessionRestart) session.writeStart(PuzzleState(*puzzle), time);
+    sessionRestart = false;
+    if (!session.writeMove(entry, time)) status = "Error: could not write session move!";
+}
+
+bool PuzzleController::canSave() {
+    // The history only matches the puzzle once every move has finished
+    return !renderer->animating && renderer->pendingMoves.empty();
+}
+
+void PuzzleController::saveFile(std::string filename) {
+    if (!canSave()) {
+        status = "Error: wait for the puzzle to stop moving!";
+        return;
+    }
+    size_t length = history->getLength();
+    MoveLog log;
+    log.scramble = scramble;
+    log.moves = history->getMoves(0, history->getPosition());
+    log.redo = history->getMoves(history->getPosition(), length);
+    // Where the history starts, which also covers random state scrambles
+    log.start = length == 0 ? PuzzleState(*puzzle) : history->getState(0);
+
+    bool written;
+    if (filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".log") == 0) {
+        HscLog hscLog;
+        if (!hscLog.fromMoves(log)) {
+            status = "Error: Hyperspeedcube logs need the scramble the history starts from!";
+            return;
+        }
+        written = hscLog.write(filename);
+    } else {
+        written = log.write(filename);
+    }
+    if (!written) {
+        status = "Error: could not write " + filename + "!";
+        return;
+    }
+    std::ostringstream saveStatus;
+    saveStatus << "Saved " << log.moves.size() << " moves to " << filename << "!";
+    status = saveStatus.str();
+}
+
+void PuzzleController::seekHistory(size_t position) {
+    if (!canSave() || !history->seek(position)) return;
+    // Jumping through the history is not solving
+    timerArmed = false;
+    timerRunning = false;
+    history->getState(position).toPuzzle(*puzzle);
+    *queuedPuzzle = *puzzle;
+    puzzleChanged = true;
+    sessionRestart = true;
+}
+
+void PuzzleController::startSolve(bool optimal) {
+    if (solving) return;
+#ifndef __EMSCRIPTEN__
+    // A solve can finish after updatePuzzle and before the menu is drawn,
+    // and its result is dropped for the new one
+    if (solveThread.joinable()) solveThread.join();
+#endif
+    // Solves the solver plays are not timed
+    timerArmed = false;
+    timerRunning = false;
+    solveOptimal = optimal;
+    solveStart = PuzzleState(*queuedPuzzle);
+    solved = false;
+    solveBest = -1;
+    sampleNodes = 0;
+    sampleTime = glfwGetTime();
+    nodeRate = 0.0;
+    solveCancelled = false;
+    solving = true;
+#ifdef __EMSCRIPTEN__
+    // No threads in the browser, so the page waits for the solve
+    runSolve();
+    finishSolve();
+#else
+    solveThread = std::thread(&PuzzleController::runSolve, this);
+#endif
+}
+
+void PuzzleController::cancelSolve() {
+    if (solving) solveCancelled = true;
+}
+
+bool PuzzleController::isSolving() {
+    return solving;
+}
+
+void PuzzleController::runSolve() {
+    if (solver == NULL) solver = new Solver();
+    Solver *current = solver;
+    current->setCancelFlag(&solveCancelled);
+    std::vector<MoveCode> moves;
+#ifndef __EMSCRIPTEN__
+    // Leave a core for the window
+    current->setThreads(std::max(std::thread::hardware_concurrency(), 2U) - 1);
+#else
+    current->setThreads(1);
+#endif
+    // Solve searches briefly for a short solution close to solved, then
+    // falls back to the beam solver, whose solutions run to thousands of
+    // moves
+    if (current->solveOptimal(solveStart, moves, solveOptimal ? 0 : SOLVE_SEARCH_NODES)) {
+        solution = moves;
+        solved = true;
+        solveBest = solution.size();
+    } else if (!solveOptimal && !solveCancelled && current->solveBeam(solveStart, moves)) {
+        solution = moves;
+        solved = true;
+        solveBest = solution.size();
+    }
+    solving = false;
+}
+
+void PuzzleController::finishSolve() {
+    if (solveCancelled) {
+        status = "Solve cancelled!";
+        return;
+    }
+    if (!solved) {
+        status = "Error: no solution found!";
+        return;
+    }
+    if (PuzzleState(*queuedPuzzle) != solveStart) {
+        status = "Error: puzzle changed while solving!";
+        return;
+    }
+    for (size_t i = 0; i < solution.size(); i++) {
+        MoveEntry entry = solveStart.getMoveEntry(solution[i]);
+        if (entry.type == GYRO) {
+            startGyro(entry.cell);
+        } else if (entry.type == TURN) {
+            startCellMove(entry.cell, entry.direction);
+        } else if (isLegal(*queuedPuzzle, entry)) {
+            scheduleMove(getMacro(*queuedPuzzle, entry)[0]);
+        }
+    }
+    std::ostringstream solveStatus;
+    solveStatus << "Solved in " << solution.size() << " moves!";
+    status = solveStatus.str();
+}
+
+void PuzzleController::showHint() {
+    if (hints == NULL) {
+        hints = new HintEngine();
+        hints->setGoal(hintGoal);
+    }
+    PuzzleState state(*queuedPuzzle);
+    MoveCode move;
+    if (!hints->getHint(state, hintBudget, move)) {
+        status = "Hint: goal already reached!";
+        return;
+    }
+    std::ostringstream hintStatus;
+    hintStatus << "Hint: " << getMoveName(state.getMoveEntry(move)) << " ("
+               << (hints->isExact() ? "" : "about ") << hints->getEstimate() << " moves to go)";
+    status = hintStatus.str();
+}
+
+void PuzzleController::setHintGoal(HintGoal goal) {
+    hintGoal = goal;
+    if (hints != NULL) hints->setGoal(goal);
+}
+
+HintGoal PuzzleController::getHintGoal() {
+    return hintGoal;
+}
+
+std::string PuzzleController::getSolveProgress() {
+    Solver *current = solver;
+    if (current == NULL) return "Solving: building tables...";
+    double now = glfwGetTime();
+    if (now - sampleTime >= 0.5) {
+        // Each search restarts the count
+        unsigned long long nodes = current->getNodes();
+        unsigned long long searched = (nodes >= sampleNodes) ? nodes - sampleNodes : nodes;
+        nodeRate = searched / (now - sampleTime);
+        sampleNodes = nodes;
+        sampleTime = now;
+    }
+    std::ostringstream progress;
+    progress << "Solving: depth " << current->getBound() << ", "
+             << (long long)(nodeRate / 1000) << "k nodes/s";
+    int best = solveBest;
+    if (best >= 0) progress << ", best " << best << " moves";
+    return progress.str();
+}
+
+void PuzzleController::armTimer() {
+    timerArmed = true;
+    timerRunning = false;
+    timerScramble = PuzzleState(*queuedPuzzle).encode();
+}
+
+void PuzzleController::stopTimer(double time) {
+    timerArmed = false;
+    timerRunning = false;
+    SolveRecord record;
+    record.date = std::time(NULL);
+    // Both ends are input times, however long the moves take to animate
+    record.time = (time - timerStart) * 1000.0;
+    record.moves = history->getTurnCount();
+    record.scramble = timerScramble;
+    stats.addSolve(record);
+    std::ostringstream solveStatus;
+    solveStatus << "Solved in " << SolveStats::formatTime(record.time) << " with " << record.moves << " moves ("
+                << std::fixed << std::setprecision(2) << SolveStats::getTps(record) << " TPS)!";
+    status = solveStatus.str();
+}
+
+SolveAnalysis PuzzleController::analyseHistory() {
+    size_t position = history->getPosition();
+    std::vector<MoveEntry> played = history->getMoves(0, position);
+    std::vector<double> times(position);
+    for (size_t i = 0; i < position; i++) {
+        times[i] = history->getTime(i);
+    }
+    return SolveAnalyser::analyse(history->getState(0), played, times);
+}
+
+std::string PuzzleController::getSolveStats() {
+    std::string text;
+    if (timerRunning) text = SolveStats::formatTime((glfwGetTime() - timerStart) * 1000.0);
+    std::string summary = stats.getSummary();
+    if (!text.empty() && !summary.empty()) text += "  ";
+    return text + summary;
+}
+
 std::string PuzzleController::getStatus() {
+    if (solving) return scramblingState ? "Scrambling to a random state..." : getSolveProgress();
     return status;
 }
 
+// Depth between the states the history keeps
+#define HISTORY_CHECKPOINT_INTERVAL 256
+
 MoveHistory::MoveHistory() {
-    turnCount = 0;
-    undoing = false;
-    redoing = false;
+    journal = NULL;
+    reset();
 }
 
 void MoveHistory::reset() {
-    turnCount = 0;
-    history.clear();
-    redoList.clear();
+    reset(PuzzleState());
 }
 
-void MoveHistory::insertMove(MoveEntry entry) {
+void MoveHistory::reset(const PuzzleState& start) {
+    HistoryNode root;
+    root.parent = HISTORY_NONE;
+    root.firstChild = HISTORY_NONE;
+    root.nextSibling = HISTORY_NONE;
+    root.redoChild = HISTORY_NONE;
+    root.checkpoint = 0;
+    root.depth = 0;
+    root.turns = 0;
+    root.code = NUM_SESSION_MOVES;
+    nodes.assign(1, root);
+    times.assign(1, -1.0);
+    checkpoints.assign(1, start);
+    line.assign(1, 0);
+    position = 0;
+    undoing = false;
+    redoing = false;
+    if (journal != NULL) journal->writeStart(start, getJournalTime());
+}
+
+void MoveHistory::insertMove(MoveEntry entry, double time) {
+    if (journal != NULL) journal->writeMove(entry, getJournalTime());
     if (undoing) {
-        if (entry.type == TURN) {
-            turnCount -= 1;
-        }
         undoing = false;
-    } else if (history.size() && isOpposite(entry, history.back())) {
-        redoList.push_back(history.back());
-        history.pop_back();
-        if (entry.type == TURN) {
-            turnCount -= 1;
-        }
-    } else {
-        if (!redoing) {
-            redoList.clear();
-        } else {
-            redoing = false;
-        }
-        history.push_back(entry);
-        if (entry.type == TURN) {
-            turnCount += 1;
-        }
+        return;
+    }
+    if (redoing) {
+        redoing = false;
+        position++;
+        times[line[position]] = time;
+        return;
+    }
+    if (position > 0 && isOpposite(entry, getMove(position - 1))) {
+        // Playing the last move backwards undoes it
+        position--;
+        return;
     }
+    // Every move the controller plays has a code
+    unsigned char code = SessionReader::getSessionCode(entry);
+    if (code == NUM_SESSION_MOVES) return;
+    unsigned int node = line[position];
+    unsigned int child = nodes[node].firstChild;
+    while (child != HISTORY_NONE && nodes[child].code != code) {
+        child = nodes[child].nextSibling;
+    }
+    if (child == HISTORY_NONE) child = addNode(node, code);
+    nodes[node].redoChild = child;
+    times[child] = time;
+    position++;
+    if (position < line.size() && line[position] == child) return;
+
+    // Switch the line over to the branch, whose redo moves are followed
+    // from its redo children when they are needed
+    line.resize(position);
+    line.push_back(child);
 }
 
 bool MoveHistory::undoMove(MoveEntry *entry) {
-    if (!history.size()) {
+    if (position == 0) {
         return false;
     }
-    MoveEntry lastEntry = history.back();
-    *entry = getOpposite(lastEntry);
+    *entry = getOpposite(getMove(position - 1));
     undoing = true;
-    redoList.push_back(lastEntry);
-    history.pop_back();
+    position--;
     return true;
 }
 
 bool MoveHistory::redoMove(MoveEntry *entry) {
-    if (!redoList.size()) {
+    if (!canRedo()) {
         return false;
     }
-    *entry = redoList.back();
-    redoList.pop_back();
+    *entry = getMove(position);
     redoing = true;
     return true;
 }
 
 bool MoveHistory::canUndo() {
-    return history.size() > 0;
+    return position > 0;
 }
 
 bool MoveHistory::canRedo() {
-    return redoList.size() > 0;
+    return nodes[line[position]].redoChild != HISTORY_NONE;
 }
 
 int MoveHistory::getTurnCount() {
-    return turnCount;
+    return nodes[line[position]].turns;
+}
+
+size_t MoveHistory::getLength() {
+    extendLine((size_t)-1);
+    return line.size() - 1;
+}
+
+MoveEntry MoveHistory::getMove(size_t index) {
+    extendLine(index + 1);
+    return SessionReader::getSessionEntry(nodes[line[index + 1]].code);
+}
+
+std::vector<MoveEntry> MoveHistory::getMoves(size_t begin, size_t end) {
+    extendLine(end);
+    std::vector<MoveEntry> moves;
+    for (size_t i = begin; i < end; i++) {
+        moves.push_back(SessionReader::getSessionEntry(nodes[line[i + 1]].code));
+    }
+    return moves;
+}
+
+size_t MoveHistory::getPosition() {
+    return position;
+}
+
+double MoveHistory::getTime(size_t index) {
+    extendLine(index + 1);
+    return times[line[index + 1]];
+}
+
+size_t MoveHistory::getNumNodes() {
+    return nodes.size() - 1;
+}
+
+void MoveHistory::setMoves(const std::vector<MoveEntry>& moves, size_t played, const PuzzleState& start) {
+    reset(start);
+    unsigned long long time = getJournalTime();
+    // Moves without a code are left out, and so not counted as played
+    size_t kept = 0;
+    for (size_t i = 0; i < moves.size(); i++) {
+        unsigned char code = SessionReader::getSessionCode(moves[i]);
+        if (code == NUM_SESSION_MOVES) continue;
+        unsigned int node = addNode(line.back(), code);
+        nodes[line.back()].redoChild = node;
+        line.push_back(node);
+        if (i < played) kept++;
+        if (journal != NULL) journal->writeMove(moves[i], time);
+    }
+    seek(kept);
+}
+
+bool MoveHistory::seek(size_t newPosition) {
+    extendLine(newPosition);
+    if (newPosition >= line.size()) return false;
+    position = newPosition;
+    undoing = false;
+    redoing = false;
+    if (journal != NULL) journal->writeSeek(position);
+    return true;
+}
+
+PuzzleState MoveHistory::getState(size_t count) {
+    extendLine(count);
+    return getNodeState(line[std::min(count, line.size() - 1)]);
+}
+
+void MoveHistory::setJournal(Journal* journal) {
+    this->journal = journal;
+    if (journal == NULL) return;
+    // Every branch is played into and back out of, the redo child last so
+    // that it is the one remembered
+    unsigned long long time = getJournalTime();
+    journal->writeStart(checkpoints[0], time);
+    std::vector<unsigned int> path(1, 0);
+    std::vector<unsigned int> children(1, HISTORY_NONE);
+    while (!path.empty()) {
+        unsigned int child = nextChild(path.back(), children.back());
+        children.back() = child;
+        if (child != HISTORY_NONE) {
+            journal->writeMove(SessionReader::getSessionEntry(nodes[child].code), time);
+            path.push_back(child);
+            children.push_back(HISTORY_NONE);
+        } else {
+            unsigned int node = path.back();
+            path.pop_back();
+            children.pop_back();
+            if (!path.empty()) journal->writeMove(getOpposite(SessionReader::getSessionEntry(nodes[node].code)), time);
+        }
+    }
+    journal->writeSeek(position);
+    // The old journal is only replaced once all of this is on disk
+    if (!journal->commit()) this->journal = NULL;
+}
+
+unsigned int MoveHistory::addNode(unsigned int parent, unsigned char code) {
+    HistoryNode node;
+    node.parent = parent;
+    node.firstChild = HISTORY_NONE;
+    node.nextSibling = nodes[parent].firstChild;
+    node.redoChild = HISTORY_NONE;
+    node.checkpoint = HISTORY_NONE;
+    node.depth = nodes[parent].depth + 1;
+    node.turns = nodes[parent].turns + (SessionReader::getSessionEntry(code).type == TURN ? 1 : 0);
+    node.code = code;
+    unsigned int index = nodes.size();
+    nodes[parent].firstChild = index;
+    nodes.push_back(node);
+    times.push_back(-1.0);
+    if (node.depth % HISTORY_CHECKPOINT_INTERVAL == 0) {
+        PuzzleState state = getNodeState(index);
+        nodes[index].checkpoint = checkpoints.size();
+        checkpoints.push_back(state);
+    }
+    return index;
+}
+
+void MoveHistory::extendLine(size_t count) {
+    while (line.size() <= count && nodes[line.back()].redoChild != HISTORY_NONE) {
+        line.push_back(nodes[line.back()].redoChild);
+    }
+}
+
+unsigned int MoveHistory::nextChild(unsigned int node, unsigned int child) {
+    // Children in order, except that the redo child comes last
+    unsigned int redo = nodes[node].redoChild;
+    if (child == redo) return HISTORY_NONE;
+    child = (child == HISTORY_NONE) ? nodes[node].firstChild : nodes[child].nextSibling;
+    if (child == redo) child = nodes[child].nextSibling;
+    return (child == HISTORY_NONE) ? redo : child;
+}
+
+PuzzleState MoveHistory::getNodeState(unsigned int node) {
+    std::vector<MoveCode> moves;
+    while (nodes[node].checkpoint == HISTORY_NONE) {
+        moves.push_back(SessionReader::getMoveCode(nodes[node].code));
+        node = nodes[node].parent;
+    }
+    PuzzleState state = checkpoints[nodes[node].checkpoint];
+    for (size_t i = moves.size(); i > 0; i--) {
+        state.applyMove(moves[i - 1]);
+    }
+    return state;
 }
 
 bool isOppositeParity(int a, int b) {
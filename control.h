@@ -24,16 +24,53 @@
 #include <GLFW/glfw3.h>
 #include <string>
 #include <random>
+#include <atomic>
+#include <thread>
 #include "render.h"
 #include "puzzle.h"
+#include "scrambler.h"
+#include "solver.h"
+#include "hint.h"
+#include "movelog.h"
+#include "notation.h"
+#include "session.h"
+#include "stats.h"
+#include "analysis.h"
 
 void showError(std::string text);
 
+// One move of the history tree
+struct HistoryNode {
+    unsigned int parent;
+    unsigned int firstChild;
+    unsigned int nextSibling;
+    // Child last moved to, which redo goes back to
+    unsigned int redoChild;
+    // Checkpoint of the state after this move, HISTORY_NONE for none
+    unsigned int checkpoint;
+    unsigned int depth;
+    int turns;
+    // Session move code
+    unsigned char code;
+};
+
+#define HISTORY_NONE 0xffffffffu
+
+// Moves played since the puzzle was reset, scrambled or loaded, kept as a
+// tree in one array. Undoing and playing something else starts a branch,
+// and playing the first move of an old branch again goes back into it with
+// all of its redo moves. The line undo, redo and the timeline step along
+// is the path to the current move and the redo moves after it. The state
+// is kept every HISTORY_CHECKPOINT_INTERVAL moves deep, so any move is at
+// most that many moves away from one, whichever branch it is on.
 class MoveHistory {
 	public:
 		MoveHistory();
 		void reset();
-		void insertMove(MoveEntry entry);
+		// Forgets every move, the puzzle being at start before the first
+		void reset(const PuzzleState& start);
+		// Time is when the move was input, in seconds of glfwGetTime
+		void insertMove(MoveEntry entry, double time);
 		bool isOpposite(MoveEntry entry1, MoveEntry entry2);
 		MoveEntry getOpposite(MoveEntry entry);
 		bool undoMove(MoveEntry* entry);
@@ -41,13 +78,42 @@ class MoveHistory {
 		bool canUndo();
 		bool canRedo();
 		int getTurnCount();
+		// Moves on the line, and how many of them are played
+		size_t getLength();
+		MoveEntry getMove(size_t index);
+		std::vector<MoveEntry> getMoves(size_t begin, size_t end);
+		size_t getPosition();
+		// When a move of the line was last input, negative for moves that
+		// were loaded or recovered instead
+		double getTime(size_t index);
+		// Moves on every branch
+		size_t getNumNodes();
+		void setMoves(const std::vector<MoveEntry>& moves, size_t played, const PuzzleState& start);
+		// Moves to a point of the line without playing anything
+		bool seek(size_t position);
+		// State after the first count moves of the line
+		PuzzleState getState(size_t count);
+		// Writes the whole tree to the journal, and every change from then on
+		void setJournal(Journal* journal);
 
 	private:
-		int turnCount;
-		std::vector<MoveEntry> history;
-		std::vector<MoveEntry> redoList;
+		Journal *journal;
+		std::vector<HistoryNode> nodes;
+		// Input time of each node, apart so the nodes stay small
+		std::vector<double> times;
+		std::vector<PuzzleState> checkpoints;
+		// Nodes of the line from the root, up to the current move and as far
+		// along its redo children as has been needed so far
+		std::vector<unsigned int> line;
+		size_t position;
 		bool undoing;
 		bool redoing;
+
+		unsigned int addNode(unsigned int parent, unsigned char code);
+		// Follows redo children until the line has count moves, or ends
+		void extendLine(size_t count);
+		unsigned int nextChild(unsigned int node, unsigned int child);
+		PuzzleState getNodeState(unsigned int node);
 };
 
 class PuzzleController {
@@ -65,27 +131,135 @@ class PuzzleController {
         void keyCallback(GLFWwindow* window, int key, int action, int mods, bool flip);
         std::string getStatus();
         bool checkOutline(GLFWwindow *window, Shader *shader, bool flip);
+        void scheduleMove(MoveEntry entry);
+        void scheduleSequence(std::vector<MoveEntry> entries, float maxLength);
         void performMove(MoveEntry entry);
         void performScramble();
         void getScrambleTwists();
 
         void resetPuzzle();
         void scramblePuzzle(int scrambleLength);
+        // Builds a random state on the solve thread and sets the puzzle to
+        // it, without scramble moves
+        void scrambleRandomState();
+        // Plays a scramble of scramble.txt, counted from 0, without animating
+        void loadScramble(size_t index);
+        bool hasScrambles();
+        // 0 until scramble.txt has been read to the end
+        size_t getNumScrambles();
         void undoMove();
         void redoMove();
+        // Opens a log, session or algorithm file
         void openFile(std::string filename);
+        // Animates an algorithm written in the notation of notation.h
+        void playAlgorithm(const std::string& text);
+        // Shows the puzzle after the first moves of the history at once
+        void seekHistory(size_t position);
+        // Writes the scramble and move history as a YAML log, or as a
+        // Hyperspeedcube log for .log files
+        void saveFile(std::string filename);
+        bool canSave();
+        // Appends every move played from now on to a binary session file,
+        // with the time it was played
+        void recordSession(std::string filename);
+        void stopRecording();
+        bool isRecording();
+        // Solves on another thread and plays the solution once found. Solve
+        // takes a short optimal search or else the beam solver, and the
+        // optimal solve searches to the end.
+        void startSolve(bool optimal);
+        void cancelSolve();
+        bool isSolving();
+        // Shows a next move towards the hint goal in the status bar
+        void showHint();
+        void setHintGoal(HintGoal goal);
+        HintGoal getHintGoal();
+        // Pace and phases of the moves played so far
+        SolveAnalysis analyseHistory();
+        // Running solve time, then the averages of every solve so far
+        std::string getSolveStats();
 
 	    static int cellKeys[];
     	static int directionKeys[];
+    	static float gyroLength;
+    	static double hintBudget;
 
 	private:
 		PuzzleRenderer *renderer;
 		Puzzle *puzzle;
+		// Puzzle state once every scheduled move has been committed
+		Puzzle *queuedPuzzle;
 		MoveHistory *history;
 		std::string status;
 		std::mt19937 rng;
-		int scrambleIndex;
+		// Built by the solve thread on first use, takes a moment
+		Scrambler *scrambler;
+		// The solve thread is building a random state rather than solving
+		bool scramblingState;
+		unsigned int stateSeed;
+		PuzzleState randomStart;
+		// Queued moves still belonging to the scramble
+		int scrambleMoves;
+		float savedAnimationSpeed;
+		// Play scrambles move by move instead of applying them instantly
+		bool animateScramble;
+		bool puzzleChanged;
 		std::vector<MoveEntry> scramble;
+		ScrambleCorpus scrambles;
+		// Built by the solve thread on first use, takes a moment
+		std::atomic<Solver*> solver;
+		std::thread solveThread;
+		// Cleared by the solve thread once it is done
+		std::atomic<bool> solving;
+		std::atomic<bool> solveCancelled;
+		bool solveOptimal;
+		PuzzleState solveStart;
+		bool solved;
+		std::vector<MoveCode> solution;
+		// Length of the best solution so far, -1 before the first
+		std::atomic<int> solveBest;
+		// Last progress sample, for nodes per second
+		unsigned long long sampleNodes;
+		double sampleTime;
+		double nodeRate;
+
+		// Built on first use, keeps what it learned between hints
+		HintEngine *hints;
+		HintGoal hintGoal;
+
+		// Set when the next move starts the history over, as the puzzle was
+		// reset or scrambled
+		bool historyRestart;
+		SessionWriter session;
+		// Set when the next move starts a new session, as the puzzle was
+		// reset, scrambled, loaded or moved along the timeline
+		bool sessionRestart;
+
+		// Autosave of the history, replayed on the next start
+		Journal journal;
+
+		// Every solve timed, kept across sessions
+		SolveStats stats;
+		// Set by a scramble, the timer then starts on the first move and
+		// stops once the puzzle is solved
+		bool timerArmed;
+		bool timerRunning;
+		double timerStart;
+		// State code of the scrambled puzzle
+		std::string timerScramble;
+
+		bool recoverJournal();
+		void openSession(std::string filename);
+		// Plays an algorithm file from solved straight into the history
+		void openAlgorithm(std::string filename, const std::vector<MoveCode>& algorithm);
+		void writeSessionMove(MoveEntry entry);
+		void armTimer();
+		void stopTimer(double time);
+		void runSolve();
+		void finishSolve();
+		std::string getSolveProgress();
+		void runRandomState();
+		void finishRandomState();
 };
 
 #endif // control.h
@@ -21,6 +21,7 @@
 #include <linmath.h>
 #include <glad/gl.h>
 #include <cstdlib>
+#include <algorithm>
 #include <imgui.h>
 #include <imgui_internal.h>
 #include <imgui_impl_glfw.h>
@@ -60,7 +61,12 @@ GuiRenderer::GuiRenderer(GLFWwindow *window, PuzzleController *controller, int w
 	this->width = width;
 	this->height = height;
 	showHelp = false;
+	showTimeline = true;
+	showAlgorithm = false;
+	showAnalysis = false;
+	algorithmText[0] = '\0';
 	modalToggle = false;
+	scrambleNumber = 1;
 
 	ImGui::CreateContext();
 	ImGui_ImplGlfw_InitForOpenGL(window, true);
@@ -97,6 +103,11 @@ bool GuiRenderer::captureMouse() {
 	return io.WantCaptureMouse;
 }
 
+bool GuiRenderer::captureKeyboard() {
+	ImGuiIO& io = ImGui::GetIO();
+	return io.WantTextInput;
+}
+
 int GuiRenderer::getTextWidth(std::string text) {
 	return ImGui::CalcTextSize(text.c_str()).x;
 }
@@ -148,6 +159,9 @@ void GuiRenderer::renderGui() {
 	ImGui::PushFont(uiFont);
 	displayMenuBar();
 	displayStatusBar();
+	displayTimeline();
+	displayAlgorithm();
+	displayAnalysis();
 	displayModal();
 #ifndef NO_DEMO_WINDOW
 	if (showDemoWindow) {
@@ -168,7 +182,17 @@ void GuiRenderer::displayMenuBar() {
 	if (ImGui::BeginMainMenuBar()) {
 		if (ImGui::BeginMenu("File")) {
 			if (ImGui::MenuItem("Open", "Ctrl+O")) checkUnsaved("open another file");
+#ifndef __EMSCRIPTEN__
+			if (ImGui::MenuItem("Save", "Ctrl+S", false, controller->canSave())) saveFile();
+			ImGui::Separator();
+			if (controller->isRecording()) {
+				if (ImGui::MenuItem("Stop recording", NULL)) controller->stopRecording();
+			} else {
+				if (ImGui::MenuItem("Record session", NULL)) recordSession();
+			}
+#else
 			if (ImGui::MenuItem("Save", "Ctrl+S", false, false)) {}
+#endif
 			ImGui::EndMenu();
 		}
 		if (ImGui::BeginMenu("Edit")) {
@@ -184,9 +208,44 @@ void GuiRenderer::displayMenuBar() {
 			}
             ImGui::Separator();
 			if (ImGui::MenuItem("Full", "Ctrl+F")) checkUnsaved("scramble", 0);
+			if (ImGui::MenuItem("Random state", NULL)) checkUnsaved("scramble to a random state");
+			if (controller->hasScrambles()) {
+				// The count is only known once a scramble past the end was asked for
+				int numScrambles = controller->getNumScrambles();
+				ImGui::Separator();
+				ImGui::SetNextItemWidth(ImGui::GetFontSize() * 8);
+				ImGui::InputInt("##scramble", &scrambleNumber);
+				scrambleNumber = std::max(1, scrambleNumber);
+				if (numScrambles > 0) scrambleNumber = std::min(scrambleNumber, numScrambles);
+				ImGui::SameLine();
+				std::string label = "from scramble.txt";
+				if (numScrambles > 0) label = "of " + std::to_string(numScrambles) + " " + label;
+				if (ImGui::MenuItem(label.c_str(), NULL)) checkUnsaved("load a scramble", scrambleNumber - 1);
+			}
+            ImGui::Separator();
+			ImGui::MenuItem("Animate scramble", NULL, &controller->animateScramble);
+			ImGui::EndMenu();
+		}
+		if (ImGui::BeginMenu("Solve")) {
+			if (ImGui::MenuItem("Hint", "Ctrl+H")) controller->showHint();
+			if (ImGui::BeginMenu("Hint goal")) {
+				displayHintGoals();
+				ImGui::EndMenu();
+			}
+			ImGui::Separator();
+			bool solving = controller->isSolving();
+			if (ImGui::MenuItem("Solve", NULL, false, !solving)) controller->startSolve(false);
+			if (ImGui::MenuItem("Solve optimally", NULL, false, !solving)) controller->startSolve(true);
+			ImGui::Separator();
+			if (ImGui::MenuItem("Cancel", NULL, false, solving)) controller->cancelSolve();
 			ImGui::EndMenu();
 		}
 		if (ImGui::BeginMenu("Tools")) {
+			ImGui::MenuItem("Show timeline", NULL, &showTimeline);
+			ImGui::MenuItem("Play algorithm", NULL, &showAlgorithm);
+			if (ImGui::MenuItem("Analyse moves", NULL, &showAnalysis) && showAnalysis) {
+				analysis = controller->analyseHistory();
+			}
 #ifndef NO_DEMO_WINDOW
 			if (ImGui::MenuItem("Show demo window", NULL, &showDemoWindow)) {}
 #endif
@@ -200,6 +259,30 @@ void GuiRenderer::displayMenuBar() {
 	}
 }
 
+void GuiRenderer::displayHintGoals() {
+	static const char *cells[] = {"In", "Out", "Right", "Left", "Up", "Down", "Front", "Back"};
+	static const char *colors[] = {"Purple", "Pink", "Red", "Orange", "White", "Yellow", "Green", "Blue"};
+	HintGoal current = controller->getHintGoal();
+	HintGoal goal = {HINT_SOLVE, 0};
+	if (ImGui::MenuItem("Whole puzzle", NULL, current.type == HINT_SOLVE)) controller->setHintGoal(goal);
+	if (ImGui::BeginMenu("Cell")) {
+		goal.type = HINT_CELL;
+		for (goal.target = 0; goal.target < 8; goal.target++) {
+			bool selected = current.type == goal.type && current.target == goal.target;
+			if (ImGui::MenuItem(cells[goal.target], NULL, selected)) controller->setHintGoal(goal);
+		}
+		ImGui::EndMenu();
+	}
+	if (ImGui::BeginMenu("Color")) {
+		goal.type = HINT_COLOR;
+		for (goal.target = 0; goal.target < 8; goal.target++) {
+			bool selected = current.type == goal.type && current.target == goal.target;
+			if (ImGui::MenuItem(colors[goal.target], NULL, selected)) controller->setHintGoal(goal);
+		}
+		ImGui::EndMenu();
+	}
+}
+
 void GuiRenderer::displayModal() {
     if (modalResolve) {
     	resolveModal();
@@ -257,13 +340,17 @@ void GuiRenderer::displayHUD() {
 		renderText("links now work lol", 5, y, red);
 	}
 
-	std::string saveWarning = "No saving in this version!";
+#ifdef __EMSCRIPTEN__
+	std::string saveWarning = "No saving in the web version!";
 	textWidth = getTextWidth(saveWarning);
 	renderText(saveWarning, width - 5 - textWidth, ImGui::GetFrameHeight(), red);
+#endif
 
 	std::string helpHint = "Help: H";
 	textWidth = getTextWidth(helpHint);
-	renderText(helpHint, width - 5 - textWidth, height - 5 - lineHeight - ImGui::GetFrameHeight(), white);
+	float bottom = height - 5 - lineHeight - ImGui::GetFrameHeight();
+	if (showTimeline && history->getLength()) bottom -= ImGui::GetFrameHeight();
+	renderText(helpHint, width - 5 - textWidth, bottom, white);
 }
 
 void GuiRenderer::displayStatusBar() {
@@ -275,6 +362,8 @@ void GuiRenderer::displayStatusBar() {
 	        ImGui::Text("%s", controller->getStatus().c_str());
 
 			std::ostringstream stream;
+			std::string solveStats = controller->getSolveStats();
+			if (!solveStats.empty()) stream << solveStats << "    ";
 			stream << "Move Count: " << history->getTurnCount();
 			std::string text = stream.str();
 
@@ -288,6 +377,71 @@ void GuiRenderer::displayStatusBar() {
 	}
 }
 
+void GuiRenderer::displayTimeline() {
+	int length = history->getLength();
+	if (!showTimeline || length == 0) return;
+	ImGuiViewport* viewport = ImGui::GetMainViewport();
+	ImGuiWindowFlags window_flags = ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_MenuBar;
+	float height = ImGui::GetFrameHeight();
+	if (ImGui::BeginViewportSideBar("##Timeline", viewport, ImGuiDir_Down, height, window_flags)) {
+		if (ImGui::BeginMenuBar()) {
+			// Moves along the history without animating, so it can be dragged
+			int position = history->getPosition();
+			ImGui::BeginDisabled(!controller->canSave());
+			ImGui::SetNextItemWidth(-1);
+			if (ImGui::SliderInt("##Timeline", &position, 0, length, "Move %d")) {
+				controller->seekHistory(position);
+			}
+			ImGui::EndDisabled();
+			ImGui::EndMenuBar();
+		}
+		ImGui::End();
+	}
+}
+
+void GuiRenderer::displayAlgorithm() {
+	if (!showAlgorithm) return;
+	ImGui::SetNextWindowSize(ImVec2(ImGui::GetFontSize() * 24, 0), ImGuiCond_FirstUseEver);
+	if (ImGui::Begin("Algorithm", &showAlgorithm)) {
+		ImGui::TextWrapped("Moves like Rx Uy' Fg, rotations x, slice gyros G, M, M' and N. "
+		                   "(A B)2, [A, B] and [A: B] repeat, commutate and conjugate.");
+		ImGui::InputTextMultiline("##algorithm", algorithmText, sizeof(algorithmText),
+		                          ImVec2(-1, ImGui::GetTextLineHeight() * 6));
+		if (ImGui::Button("Play")) controller->playAlgorithm(algorithmText);
+	}
+	ImGui::End();
+}
+
+void GuiRenderer::displayAnalysis() {
+	if (!showAnalysis) return;
+	static const char *cellNames[] = {"I", "O", "R", "L", "U", "D", "F", "B"};
+	if (ImGui::Begin("Analysis", &showAnalysis, ImGuiWindowFlags_AlwaysAutoResize)) {
+		if (ImGui::Button("Update")) analysis = controller->analyseHistory();
+		ImGui::Text("%d turns in %.2f s, %.2f TPS", analysis.turns, analysis.duration, analysis.tps);
+		ImGui::Text("Pauses: median %.2f s, longest %.2f s", analysis.medianPause, analysis.longestPause);
+		for (int i = 0; i < NUM_PAUSE_BUCKETS; i++) {
+			if (i < NUM_PAUSE_LIMITS) {
+				ImGui::Text("  under %.2f s: %lu", SolveAnalysis::pauseLimits[i], (unsigned long)analysis.pauses[i]);
+			} else {
+				ImGui::Text("  longer: %lu", (unsigned long)analysis.pauses[i]);
+			}
+		}
+		ImGui::Separator();
+		// Each phase runs from the end of the one before
+		int turns = 0;
+		double time = 0.0;
+		for (size_t i = 0; i < analysis.phases.size(); i++) {
+			const PhaseSplit& phase = analysis.phases[i];
+			ImGui::Text("%s solved at %.2f s: %.2f s, %d turns", cellNames[phase.cell], phase.time,
+			            phase.time - time, phase.turns - turns);
+			turns = phase.turns;
+			time = phase.time;
+		}
+		if (analysis.phases.empty()) ImGui::Text("No cell solved yet");
+	}
+	ImGui::End();
+}
+
 void GuiRenderer::toggleHelp() {
 	showHelp = !showHelp;
 }
@@ -303,9 +457,15 @@ void GuiRenderer::keyCallback(GLFWwindow* window, int key, int action, int mods)
 				checkUnsaved("scramble", 0);
 			} else if (key == GLFW_KEY_R) {
 				checkUnsaved("reset puzzle");
+			} else if (key == GLFW_KEY_H) {
+				controller->showHint();
 			} else if (key == GLFW_KEY_O) {
 #ifndef __EMSCRIPTEN__
 				checkUnsaved("open another file");
+#endif
+			} else if (key == GLFW_KEY_S) {
+#ifndef __EMSCRIPTEN__
+				saveFile();
 #endif
 			}
 		}
@@ -326,14 +486,18 @@ void GuiRenderer::resolveModal() {
 	if (modalText == "reset puzzle") {
 		controller->resetPuzzle();
 	} else if (modalText == "scramble") {
-		controller->resetPuzzle();
 		controller->scramblePuzzle(modalArg);
+	} else if (modalText == "load a scramble") {
+		controller->loadScramble(modalArg);
+	} else if (modalText == "scramble to a random state") {
+		controller->scrambleRandomState();
 	} else if (modalText == "open another file") {
 #ifndef __EMSCRIPTEN__
 		nfdchar_t *outPath = NULL;
 		nfdresult_t result = NFD_OpenDialog(NULL, NULL, &outPath);
 		if (result == NFD_OKAY) {
 			std::string file(outPath);
+			free(outPath);
 			controller->openFile(file);
 		}
 #endif
@@ -341,3 +505,27 @@ void GuiRenderer::resolveModal() {
 		// todo
 	}
 }
+
+void GuiRenderer::saveFile() {
+#ifndef __EMSCRIPTEN__
+	nfdchar_t *outPath = NULL;
+	nfdresult_t result = NFD_SaveDialog("yml,yaml;log", NULL, &outPath);
+	if (result == NFD_OKAY) {
+		std::string file(outPath);
+		free(outPath);
+		controller->saveFile(file);
+	}
+#endif
+}
+
+void GuiRenderer::recordSession() {
+#ifndef __EMSCRIPTEN__
+	nfdchar_t *outPath = NULL;
+	nfdresult_t result = NFD_SaveDialog("session", NULL, &outPath);
+	if (result == NFD_OKAY) {
+		std::string file(outPath);
+		free(outPath);
+		controller->recordSession(file);
+	}
+#endif
+}
@@ -48,22 +48,39 @@ class GuiRenderer {
 		void displayHUD();
 		void displayModal();
 		void displayStatusBar();
+		void displayHintGoals();
+		void displayTimeline();
+		void displayAlgorithm();
+		void displayAnalysis();
 		bool captureMouse();
+		// Whether a text field is taking the keys
+		bool captureKeyboard();
 
 		void keyCallback(GLFWwindow* window, int key, int action, int mods);
 		void resolveModal();
 		void toggleHelp();
 		void checkUnsaved(std::string action);
 		void checkUnsaved(std::string action, int argument);
+		void saveFile();
+		void recordSession();
 
 	private:
         PuzzleController *controller;
         MoveHistory *history;
 		int width, height;
 		bool showHelp;
+		bool showTimeline;
+		bool showAlgorithm;
+		bool showAnalysis;
+		// Worked out when asked for, as it replays the whole history
+		SolveAnalysis analysis;
+		// Typed into the algorithm window
+		char algorithmText[4096];
 		bool modalToggle, modalResolve;
 		std::string modalText;
 		int modalArg;
+		// Counted from 1, as shown
+		int scrambleNumber;
 		ImFont *hudFont, *uiFont;
 
 #ifndef NO_DEMO_WINDOW
@@ -3,7 +3,7 @@ CXXFLAGS = --std=c++11
 ifeq ($(OS),Windows_NT)
 	CCLIBFLAGS = -Llib -lglfw3 -lopengl32 -lgdi32 -lshell32 -lole32 -luuid
 else
-	CCLIBFLAGS = -Llib -lglfw -lGL
+	CCLIBFLAGS = -Llib -lglfw -lGL -pthread
 endif
 
 ifeq ($(MAKECMDGOALS),build)
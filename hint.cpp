@@ -0,0 +1,490 @@
+/**************************************************************************
+ * 3to4++ - https://github.com/rayzchen/3to4++
+ *-------------------------------------------------------------------------
+ * Copyright 2024 Ray Chen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ **************************************************************************/
+
+#include "hint.h"
+#include "solver.h"
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cmath>
+
+#define HINT_TABLE_BITS 18
+// Turns from the goal kept in the perimeter, and the size of its table,
+// which holds every state up to that depth with room to spare
+#define PERIMETER_DEPTH 3
+#define PERIMETER_BITS 15
+#define MAX_HINT_DEPTH 12
+// Nodes between looks at the clock
+#define HINT_CLOCK_NODES 64
+#define UNREACHED 255
+
+struct HintTables {
+    std::array<int, NUM_SLOTS> size;
+    // Piece codes after each move, by piece size
+    std::array<std::vector<std::array<unsigned short, NUM_MOVES> >, 5> codeMoves;
+    // Fewest moves to one code of a piece from another, by piece size,
+    // with the codes moved to outermost
+    std::array<std::vector<unsigned char>, 5> distances;
+    std::vector<int> centers;
+    // Solved orientation by the codes of the first few centers, which are
+    // enough to tell them apart
+    std::vector<short> orientations;
+    int orientationCenters;
+    // Code of every piece at home, in each orientation
+    std::vector<std::array<unsigned short, NUM_SLOTS> > homes;
+    // Piece each orientation puts in every slot
+    std::vector<std::array<unsigned char, NUM_SLOTS> > pieces;
+    // Slots with a sticker in each cell
+    std::array<std::vector<int>, 8> cellSlots;
+
+    HintTables();
+};
+
+static const HintTables& getTables() {
+    static HintTables tables;
+    return tables;
+}
+
+HintTables::HintTables() {
+    for (int slot = 0; slot < NUM_SLOTS; slot++) {
+        size[slot] = PuzzleState::getSlotSize(slot);
+        std::vector<bool> inCell(8, false);
+        for (int i = 0; i < size[slot]; i++) {
+            inCell[PuzzleState::getStickerColor(PuzzleState::getSlotSticker(slot) + i)] = true;
+        }
+        for (int cell = 0; cell < 8; cell++) {
+            if (inCell[cell]) cellSlots[cell].push_back(slot);
+        }
+    }
+
+    // Breadth first from every code of a piece of each size
+    std::vector<MoveCode> moves = MoveAutomaton(Solver::getSearchMoves(SolverMetric::turnMetric()))
+                                      .getMoves(MoveAutomaton::getStart());
+    for (int pieceSize = 1; pieceSize <= 4; pieceSize++) {
+        int piece = PuzzleState::getOrbit(pieceSize)[0];
+        int count = PatternDatabase::getNumPieceCodes(piece);
+        codeMoves[pieceSize].resize(count);
+        for (int code = 0; code < count; code++) {
+            for (int move = 0; move < NUM_MOVES; move++) {
+                codeMoves[pieceSize][code][move] = PatternDatabase::movePieceCode(piece, code, move);
+            }
+        }
+        std::vector<unsigned char>& table = distances[pieceSize];
+        table.assign(count * count, UNREACHED);
+        std::vector<unsigned short> queue;
+        std::vector<unsigned char> row(count);
+        for (int from = 0; from < count; from++) {
+            row.assign(count, UNREACHED);
+            row[from] = 0;
+            queue.assign(1, from);
+            for (size_t i = 0; i < queue.size(); i++) {
+                for (size_t m = 0; m < moves.size(); m++) {
+                    unsigned short next = codeMoves[pieceSize][queue[i]][moves[m]];
+                    if (row[next] != UNREACHED) continue;
+                    row[next] = row[queue[i]] + 1;
+                    queue.push_back(next);
+                }
+            }
+            for (int to = 0; to < count; to++) {
+                table[to * count + from] = row[to];
+            }
+        }
+    }
+
+    const std::vector<PuzzleState>& solvedStates = Solver::getSolvedStates();
+    for (size_t i = 0; i < solvedStates.size(); i++) {
+        std::array<unsigned short, NUM_SLOTS> codes;
+        for (int piece = 0; piece < NUM_SLOTS; piece++) {
+            codes[piece] = PatternDatabase::getPieceCode(solvedStates[i], piece);
+        }
+        homes.push_back(codes);
+        pieces.push_back(solvedStates[i].getPieces());
+    }
+    centers = PuzzleState::getOrbit(1);
+    size_t radix = codeMoves[1].size();
+    for (orientationCenters = 1; orientationCenters <= (int)centers.size(); orientationCenters++) {
+        orientations.assign((size_t)std::pow(radix, orientationCenters), -1);
+        bool unique = true;
+        for (size_t i = 0; i < homes.size() && unique; i++) {
+            size_t index = 0;
+            for (int j = 0; j < orientationCenters; j++) {
+                index = index * radix + homes[i][centers[j]];
+            }
+            unique = orientations[index] == -1;
+            orientations[index] = i;
+        }
+        if (unique) break;
+    }
+}
+
+HintEngine::HintEngine() : automaton(Solver::getSearchMoves(SolverMetric::turnMetric())) {
+    std::vector<MoveCode> moves = Solver::getSearchMoves(SolverMetric::turnMetric());
+    moves.erase(std::remove_if(moves.begin(), moves.end(), [](MoveCode move) { return move >= MOVE_GYRO; }),
+                moves.end());
+    turns = MoveAutomaton(moves).getMoves(MoveAutomaton::getStart());
+    codes.assign(MAX_HINT_DEPTH + 1, std::vector<unsigned short>(NUM_SLOTS));
+    nodes = 0;
+    nodeBudget = 0;
+    nodeDeadline = 0;
+    timed = false;
+    aborted = false;
+    depth = 0;
+    estimate = 0;
+    exact = false;
+    HintGoal solve = {HINT_SOLVE, 0};
+    setGoal(solve);
+}
+
+void HintEngine::setGoal(const HintGoal& goal) {
+    const HintTables& tables = getTables();
+    this->goal = goal;
+    targets.assign(tables.homes.size(), std::vector<Target>());
+    for (size_t i = 0; i < tables.homes.size(); i++) {
+        std::vector<int> pieces;
+        if (goal.type == HINT_SOLVE) {
+            for (int piece = 0; piece < NUM_SLOTS; piece++) {
+                pieces.push_back(piece);
+            }
+        } else if (goal.type == HINT_COLOR) {
+            // Solved, a piece sits in every cell it has a color of
+            pieces = tables.cellSlots[goal.target];
+        } else {
+            const std::vector<int>& slots = tables.cellSlots[goal.target];
+            for (size_t j = 0; j < slots.size(); j++) {
+                pieces.push_back(tables.pieces[i][slots[j]]);
+            }
+        }
+        for (size_t j = 0; j < pieces.size(); j++) {
+            int pieceSize = tables.size[pieces[j]];
+            // Centers only pick the orientation
+            if (pieceSize == 1) continue;
+            Target target;
+            target.piece = pieces[j];
+            target.distances = &tables.distances[pieceSize][tables.homes[i][pieces[j]] * tables.codeMoves[pieceSize].size()];
+            targets[i].push_back(target);
+        }
+    }
+    table.assign((size_t)1 << HINT_TABLE_BITS, Entry());
+    perimeter.clear();
+    perimeterOrientation = -1;
+    visits.clear();
+    plan.clear();
+}
+
+const HintGoal& HintEngine::getGoal() const {
+    return goal;
+}
+
+int HintEngine::getDistance(const PuzzleState& state) const {
+    std::vector<unsigned short> codes(NUM_SLOTS);
+    for (int piece = 0; piece < NUM_SLOTS; piece++) {
+        codes[piece] = PatternDatabase::getPieceCode(state, piece);
+    }
+    return heuristic(codes, false);
+}
+
+bool HintEngine::getHint(const PuzzleState& state, double budget, MoveCode& move) {
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::duration time =
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(budget));
+    for (int piece = 0; piece < NUM_SLOTS; piece++) {
+        codes[0][piece] = PatternDatabase::getPieceCode(state, piece);
+    }
+    if (heuristic(codes[0], false) == 0) {
+        plan.clear();
+        return false;
+    }
+    visits[getKey(codes[0])]++;
+
+    // Following the last solution needs no search
+    if (!plan.empty() && codes[0] == planCodes) {
+        move = plan[0];
+        plan.erase(plan.begin());
+        estimate = plan.size() + 1;
+        playMove(0, move);
+        planCodes = codes[1];
+        return true;
+    }
+
+    // A shortest solution, if one turns up in the first half of the time.
+    // Only gyros move the centers, so the perimeter is built again after
+    // one.
+    plan.clear();
+    if (getOrientation(codes[0]) != perimeterOrientation) buildPerimeter(getOrientation(codes[0]));
+    deadline = begin + time / 2;
+    nodes = 0;
+    nodeDeadline = nodeBudget / 2;
+    timed = true;
+    aborted = false;
+    int start = MoveAutomaton::getStart();
+    int bound = heuristic(codes[0], true);
+    while (bound > 0 && bound <= MAX_HINT_DEPTH && !aborted) {
+        path.clear();
+        bound = search(0, bound, start);
+    }
+    if (bound == 0) {
+        move = path[0];
+        plan.assign(path.begin() + 1, path.end());
+        depth = path.size();
+        estimate = path.size();
+        exact = true;
+        playMove(0, move);
+        planCodes = codes[1];
+        return true;
+    }
+
+    // Otherwise deepen until the time runs out, keeping the last finished
+    // answer
+    deadline = begin + time;
+    nodeDeadline = nodeBudget;
+    timed = false;
+    aborted = false;
+    const std::vector<MoveCode>& next = automaton.getMoves(start);
+    for (int limit = 1; limit <= MAX_HINT_DEPTH; limit++) {
+        int bestVisits = INT_MAX;
+        int bestValue = INT_MAX;
+        int bestDistance = INT_MAX;
+        MoveCode bestMove = next[0];
+        for (size_t m = 0; m < next.size() && !isExpired(); m++) {
+            playMove(0, next[m]);
+            int visited = getVisits(codes[1]);
+            int distance = heuristic(codes[1], false);
+            int value = 1 + lookahead(1, limit - 1, automaton.getNext(start, next[m]));
+            // States hinted from before go last, so hints cannot go round in
+            // circles. Ties go to the move that helps most right away.
+            if (visited < bestVisits || (visited == bestVisits && (value < bestValue ||
+                                         (value == bestValue && distance < bestDistance)))) {
+                bestVisits = visited;
+                bestValue = value;
+                bestDistance = distance;
+                bestMove = next[m];
+            }
+        }
+        if (aborted) break;
+        move = bestMove;
+        depth = limit;
+        estimate = bestValue;
+        timed = true;
+        // Leaves short of the goal are worth more than the limit, so a
+        // value within it means the goal is in sight
+        if (bestValue <= limit) break;
+    }
+    exact = false;
+
+    // Coming back here later should look worse than it did
+    unsigned long long key = getKey(codes[0]);
+    Entry& entry = table[key & (((size_t)1 << HINT_TABLE_BITS) - 1)];
+    if (entry.key != key || entry.value < estimate) {
+        entry.key = key;
+        entry.value = std::min(estimate, SHRT_MAX);
+        entry.depth = depth;
+    }
+    return true;
+}
+
+void HintEngine::setNodeBudget(unsigned long long nodes) {
+    nodeBudget = nodes;
+}
+
+int HintEngine::getDepth() const {
+    return depth;
+}
+
+int HintEngine::getEstimate() const {
+    return estimate;
+}
+
+bool HintEngine::isExact() const {
+    return exact;
+}
+
+int HintEngine::heuristic(const std::vector<unsigned short>& codes, bool lower) const {
+    const std::vector<Target>& pieces = targets[getOrientation(codes)];
+    int h = 0;
+    for (size_t i = 0; i < pieces.size(); i++) {
+        int distance = pieces[i].distances[codes[pieces[i].piece]];
+        h = lower ? std::max(h, distance) : h + distance;
+    }
+    return h;
+}
+
+int HintEngine::getOrientation(const std::vector<unsigned short>& codes) const {
+    const HintTables& tables = getTables();
+    size_t radix = tables.codeMoves[1].size();
+    size_t index = 0;
+    for (int i = 0; i < tables.orientationCenters; i++) {
+        index = index * radix + codes[tables.centers[i]];
+    }
+    // The centers always sit like those of some solved orientation
+    return std::max<int>(tables.orientations[index], 0);
+}
+
+unsigned long long HintEngine::getGoalKey(const std::vector<unsigned short>& codes, int orientation) const {
+    const std::vector<Target>& pieces = targets[orientation];
+    unsigned long long hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < pieces.size(); i++) {
+        hash = (hash ^ codes[pieces[i].piece]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+void HintEngine::buildPerimeter(int orientation) {
+    const HintTables& tables = getTables();
+    size_t mask = ((size_t)1 << PERIMETER_BITS) - 1;
+    perimeter.assign(mask + 1, Entry());
+    perimeterOrientation = orientation;
+    // Breadth first from the goal over the turns, keeping one state for
+    // each way the goal pieces can sit
+    std::vector<unsigned short> layer(tables.homes[orientation].begin(), tables.homes[orientation].end());
+    std::vector<unsigned short> nextLayer;
+    std::vector<unsigned short> child(NUM_SLOTS);
+    perimeter[getGoalKey(layer, orientation) & mask].key = getGoalKey(layer, orientation);
+    for (int distance = 1; distance <= PERIMETER_DEPTH; distance++) {
+        nextLayer.clear();
+        for (size_t i = 0; i < layer.size(); i += NUM_SLOTS) {
+            for (size_t m = 0; m < turns.size(); m++) {
+                for (int piece = 0; piece < NUM_SLOTS; piece++) {
+                    child[piece] = tables.codeMoves[tables.size[piece]][layer[i + piece]][turns[m]];
+                }
+                unsigned long long key = getGoalKey(child, orientation);
+                size_t index = key & mask;
+                while (perimeter[index].key != 0 && perimeter[index].key != key) {
+                    index = (index + 1) & mask;
+                }
+                if (perimeter[index].key == key) continue;
+                perimeter[index].key = key;
+                perimeter[index].value = distance;
+                if (distance < PERIMETER_DEPTH) nextLayer.insert(nextLayer.end(), child.begin(), child.end());
+            }
+        }
+        layer.swap(nextLayer);
+    }
+}
+
+int HintEngine::getPerimeterDistance(const std::vector<unsigned short>& codes) const {
+    if (getOrientation(codes) != perimeterOrientation) return -1;
+    size_t mask = perimeter.size() - 1;
+    unsigned long long key = getGoalKey(codes, perimeterOrientation);
+    for (size_t index = key & mask; perimeter[index].key != 0; index = (index + 1) & mask) {
+        if (perimeter[index].key == key) return perimeter[index].value;
+    }
+    return -1;
+}
+
+void HintEngine::finishPerimeter(int depth, int distance) {
+    // Undoing the turn a state was first reached with always gets closer
+    while (distance > 0) {
+        for (size_t m = 0; m < turns.size(); m++) {
+            playMove(depth, turns[m]);
+            int next = getPerimeterDistance(codes[depth + 1]);
+            if (next >= 0 && next < distance) {
+                path.push_back(turns[m]);
+                distance = next;
+                depth++;
+                break;
+            }
+        }
+    }
+}
+
+int HintEngine::getVisits(const std::vector<unsigned short>& codes) const {
+    std::unordered_map<unsigned long long, int>::const_iterator it = visits.find(getKey(codes));
+    return it == visits.end() ? 0 : it->second;
+}
+
+// IDA* step, 0 once the goal is reached
+int HintEngine::search(int depth, int bound, int sequence) {
+    if (isExpired()) return INT_MAX;
+    int h = heuristic(codes[depth], true);
+    if (h == 0) return 0;
+    int distance = getPerimeterDistance(codes[depth]);
+    if (distance >= 0 && depth + distance <= bound) {
+        finishPerimeter(depth, distance);
+        return 0;
+    }
+    if (depth + h > bound) return depth + h;
+    int minimum = INT_MAX;
+    const std::vector<MoveCode>& next = automaton.getMoves(sequence);
+    for (size_t m = 0; m < next.size(); m++) {
+        playMove(depth, next[m]);
+        path.push_back(next[m]);
+        int result = search(depth + 1, bound, automaton.getNext(sequence, next[m]));
+        if (result == 0) return 0;
+        path.pop_back();
+        minimum = std::min(minimum, result);
+        if (aborted) break;
+    }
+    return minimum;
+}
+
+int HintEngine::lookahead(int depth, int remaining, int sequence) {
+    if (isExpired()) return INT_MAX / 2;
+    int h = heuristic(codes[depth], false);
+    if (h == 0) return 0;
+    int distance = getPerimeterDistance(codes[depth]);
+    if (distance >= 0) return distance;
+
+    // Learned values stand in for the heuristic too
+    unsigned long long key = getKey(codes[depth]);
+    Entry& entry = table[key & (((size_t)1 << HINT_TABLE_BITS) - 1)];
+    if (entry.key == key && entry.depth >= remaining) return entry.value;
+    if (remaining == 0) return h;
+
+    int best = INT_MAX / 2;
+    const std::vector<MoveCode>& next = automaton.getMoves(sequence);
+    for (size_t m = 0; m < next.size(); m++) {
+        playMove(depth, next[m]);
+        best = std::min(best, 1 + lookahead(depth + 1, remaining - 1, automaton.getNext(sequence, next[m])));
+        if (aborted) return best;
+    }
+    // Collisions just replace the older state
+    entry.key = key;
+    entry.value = std::min(best, SHRT_MAX);
+    entry.depth = remaining;
+    return best;
+}
+
+bool HintEngine::isExpired() {
+    if (!timed) return aborted;
+    nodes++;
+    if (nodeBudget > 0) {
+        if (nodes >= nodeDeadline) aborted = true;
+    } else if (nodes % HINT_CLOCK_NODES == 0 && std::chrono::steady_clock::now() > deadline) {
+        aborted = true;
+    }
+    return aborted;
+}
+
+void HintEngine::playMove(int depth, MoveCode move) {
+    const HintTables& tables = getTables();
+    const std::vector<unsigned short>& current = codes[depth];
+    std::vector<unsigned short>& child = codes[depth + 1];
+    for (int piece = 0; piece < NUM_SLOTS; piece++) {
+        child[piece] = tables.codeMoves[tables.size[piece]][current[piece]][move];
+    }
+}
+
+unsigned long long HintEngine::getKey(const std::vector<unsigned short>& codes) {
+    // FNV-1a over the piece codes
+    unsigned long long hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < codes.size(); i++) {
+        hash = (hash ^ codes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
@@ -0,0 +1,134 @@
+/**************************************************************************
+ * 3to4++ - https://github.com/rayzchen/3to4++
+ *-------------------------------------------------------------------------
+ * Copyright 2024 Ray Chen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ **************************************************************************/
+
+#ifndef HINT_H
+#define HINT_H
+
+#include <vector>
+#include <chrono>
+#include <unordered_map>
+#include "state.h"
+
+// Pieces a hint works towards. A piece is home when it sits where the
+// centers say it belongs, so the goal holds in any orientation.
+typedef enum : int {
+    HINT_SOLVE, // every piece
+    HINT_CELL, // pieces of the cell at a location, whatever its color
+    HINT_COLOR // pieces with a sticker of a color
+} HintGoalType;
+
+struct HintGoal {
+    HintGoalType type;
+    int target; // CellLocation for HINT_CELL, Color for HINT_COLOR
+};
+
+// Picks a next move towards a goal within a time budget. Near the goal it
+// finds a shortest way there, searching towards the states a few turns
+// from the goal, and hands it out a move at a time while the hints are
+// followed. Otherwise it looks ahead as deep as the rest of the budget
+// allows and scores the states it stops at by how far each goal piece is
+// from home on its own. What it finds is kept per state, so asking again
+// or following the hint carries on from the last search, and hints never
+// lead back to a state already hinted from while another move is left.
+class HintEngine {
+    public:
+        HintEngine();
+        // Forgets everything learned about the old goal
+        void setGoal(const HintGoal& goal);
+        const HintGoal& getGoal() const;
+        // Sum of the moves each goal piece needs, 0 once the goal is reached
+        int getDistance(const PuzzleState& state) const;
+        // Best move found within budget seconds, false if the goal is
+        // already reached. At least one move deep is always searched.
+        bool getHint(const PuzzleState& state, double budget, MoveCode& move);
+        // Ends searches after this many nodes instead of at the time budget,
+        // so hints come out the same on any machine. 0 goes back to time.
+        void setNodeBudget(unsigned long long nodes);
+        // Lookahead of the last hint, and the moves it expects are left
+        int getDepth() const;
+        int getEstimate() const;
+        // Whether the estimate is the exact number of moves left
+        bool isExact() const;
+
+    private:
+        // Lookahead value of a state, from a search this many moves deep
+        struct Entry {
+            unsigned long long key;
+            short value;
+            short depth;
+        };
+
+        // Goal piece and its distance home from each code
+        struct Target {
+            int piece;
+            const unsigned char *distances;
+        };
+
+        HintGoal goal;
+        MoveAutomaton automaton;
+        // Turns without the moves they repeat. Turns keep the centers, so
+        // the goal stays in the same orientation.
+        std::vector<MoveCode> turns;
+        // Goal pieces for each solved orientation
+        std::vector<std::vector<Target> > targets;
+        std::vector<Entry> table;
+        // Goal pieces of every state a few turns from the goal, with the
+        // turns left as the value, for the orientation of the last hint
+        std::vector<Entry> perimeter;
+        int perimeterOrientation;
+        // Hints given from each state since the goal was set
+        std::unordered_map<unsigned long long, int> visits;
+        // Rest of the last shortest solution, and the codes it expects
+        std::vector<MoveCode> plan;
+        std::vector<unsigned short> planCodes;
+        // Piece codes of every slot at each depth, and the moves to them
+        std::vector<std::vector<unsigned short> > codes;
+        std::vector<MoveCode> path;
+        std::chrono::steady_clock::time_point deadline;
+        unsigned long long nodes;
+        unsigned long long nodeBudget;
+        // Node count at which the current search gives up, with a budget
+        unsigned long long nodeDeadline;
+        // Clear while the first lookahead runs, which always finishes
+        bool timed;
+        bool aborted;
+        int depth;
+        int estimate;
+        bool exact;
+
+        // Sum of the distances home of the goal pieces, or the largest,
+        // which never overestimates
+        int heuristic(const std::vector<unsigned short>& codes, bool lower) const;
+        // Solved orientation the centers are in
+        int getOrientation(const std::vector<unsigned short>& codes) const;
+        unsigned long long getGoalKey(const std::vector<unsigned short>& codes, int orientation) const;
+        void buildPerimeter(int orientation);
+        // Turns left to the goal, -1 outside the perimeter
+        int getPerimeterDistance(const std::vector<unsigned short>& codes) const;
+        // Appends to path the turns from depth to the goal
+        void finishPerimeter(int depth, int distance);
+        int getVisits(const std::vector<unsigned short>& codes) const;
+        int search(int depth, int bound, int sequence);
+        int lookahead(int depth, int remaining, int sequence);
+        bool isExpired();
+        void playMove(int depth, MoveCode move);
+        static unsigned long long getKey(const std::vector<unsigned short>& codes);
+};
+
+#endif // hint.h
@@ -0,0 +1,168 @@
+/**************************************************************************
+ * 3to4++ - https://github.com/rayzchen/3to4++
+ *-------------------------------------------------------------------------
+ * Copyright 2024 Ray Chen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ **************************************************************************/
+
+
+#include "hsc.h"
+#include <cctype>
+
+const HscTwist HscTranslator::orientation = {0, 0, 7};
+
+// Whole puzzle twists for cell gyros, indexed by cell, RIGHT to BACK
+static const int gyroMoves[6][2] = {
+    {2, 4}, // U cell turns F
+    {2, 5}, // U cell turns B
+    {4, 0}, // F cell turns R
+    {4, 1}, // F cell turns L
+    {2, 1}, // U cell turns R
+    {2, 0} // U cell turns L
+};
+
+// Hyperspeedcube numbers cells R, L, U, D, F, B, O, I
+static int getHscCell(CellLocation cell) {
+    if (cell == IN) return 7;
+    if (cell == OUT) return 6;
+    return (int)cell - 2;
+}
+
+bool HscTranslator::getTwist(const MoveEntry& entry, HscTwist& twist) {
+    switch (entry.type) {
+        case TURN:
+            twist.cell = getHscCell(entry.cell);
+            twist.direction = (int)entry.direction;
+            if (twist.cell >= 2 && twist.cell < 6) twist.direction += 6;
+            twist.layers = 1;
+            return true;
+        case GYRO:
+            twist.cell = gyroMoves[entry.cell - RIGHT][0];
+            twist.direction = gyroMoves[entry.cell - RIGHT][1];
+            twist.layers = 7;
+            return true;
+        case ROTATE:
+            // Turned by the L cell, as the same turn by the R cell is the
+            // orientation twist that starts every scramble
+            twist.cell = 1;
+            twist.direction = (int)entry.direction;
+            twist.layers = 7;
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool HscTranslator::getMove(const HscTwist& twist, MoveEntry& entry) {
+    PuzzleState solved;
+    if (twist.layers == 7) {
+        for (int cell = RIGHT; cell <= BACK; cell++) {
+            if (gyroMoves[cell - RIGHT][0] == twist.cell && gyroMoves[cell - RIGHT][1] == twist.direction) {
+                entry = solved.getMoveEntry((MoveCode)(MOVE_GYRO + cell - RIGHT));
+                return true;
+            }
+        }
+        if (twist.cell > 1 || (twist.direction != ZY && twist.direction != YZ)) return false;
+        entry = solved.getMoveEntry((MoveCode)(MOVE_ROTATE + twist.direction));
+        return true;
+    }
+    if (twist.layers != 1 || twist.cell < 0 || twist.cell >= 8) return false;
+    entry.type = TURN;
+    entry.cell = (twist.cell == 7) ? IN : (twist.cell == 6) ? OUT : (CellLocation)(twist.cell + 2);
+    int direction = twist.direction;
+    if (twist.cell >= 2 && twist.cell < 6) direction -= 6;
+    if (direction < 0 || direction >= 6) return false;
+    entry.direction = (RotateDirection)direction;
+    // Only turns the physical puzzle can make have a code
+    MoveCode move = PuzzleState::getMoveCode(entry);
+    if (move == NUM_MOVES) return false;
+    entry = solved.getMoveEntry(move);
+    return true;
+}
+
+std::vector<HscTwist> HscTranslator::toTwists(const std::vector<MoveEntry>& moves) {
+    std::vector<HscTwist> twists;
+    twists.reserve(moves.size());
+    HscTwist twist;
+    for (size_t i = 0; i < moves.size(); i++) {
+        if (getTwist(moves[i], twist)) twists.push_back(twist);
+    }
+    return twists;
+}
+
+size_t HscTranslator::toMoves(const std::vector<HscTwist>& twists, PuzzleState& state, std::vector<MoveEntry>& moves) {
+    MoveEntry entry;
+    for (size_t i = 0; i < twists.size(); i++) {
+        if (!getMove(twists[i], entry)) return i;
+        MoveCode move = PuzzleState::getMoveCode(entry);
+        // Turns and gyros bring their own slice gyros along, but rotations
+        // need the slices lined up already
+        if (move >= MOVE_ROTATE && !((PuzzleState::getLegalMoves(state.config) >> move) & 1)) return i;
+        const std::vector<MoveEntry>& macro = PuzzleState::getMacro(state.config, move);
+        if (macro.empty()) return i;
+        for (size_t j = 0; j < macro.size(); j++) {
+            moves.push_back(macro[j]);
+            state.applyMove(PuzzleState::getMoveCode(macro[j]));
+        }
+    }
+    return twists.size();
+}
+
+// Twists are formatted in bulk, so skip the stream machinery
+static void appendNumber(std::string& text, int value) {
+    if (value < 0) {
+        text += '-';
+        value = -value;
+    }
+    if (value >= 10) text += (char)('0' + value / 10);
+    text += (char)('0' + value % 10);
+}
+
+void HscTranslator::appendTwists(std::string& text, const std::vector<HscTwist>& twists) {
+    text.reserve(text.size() + twists.size() * 7);
+    for (size_t i = 0; i < twists.size(); i++) {
+        if (i > 0) text += ' ';
+        appendNumber(text, twists[i].cell);
+        text += ',';
+        appendNumber(text, twists[i].direction);
+        text += ',';
+        appendNumber(text, twists[i].layers);
+    }
+}
+
+static bool parseNumber(const char *text, size_t length, size_t& offset, int& value) {
+    size_t start = offset;
+    value = 0;
+    while (offset < length && isdigit((unsigned char)text[offset]) && offset - start < 9) {
+        value = value * 10 + (text[offset++] - '0');
+    }
+    return offset > start;
+}
+
+bool HscTranslator::parseTwists(const char *text, size_t length, std::vector<HscTwist>& twists) {
+    size_t offset = 0;
+    HscTwist twist;
+    while (true) {
+        while (offset < length && isspace((unsigned char)text[offset])) offset++;
+        if (offset == length) return true;
+        if (!parseNumber(text, length, offset, twist.cell) || offset == length || text[offset++] != ',' ||
+            !parseNumber(text, length, offset, twist.direction) || offset == length || text[offset++] != ',' ||
+            !parseNumber(text, length, offset, twist.layers)) {
+            return false;
+        }
+        if (offset < length && !isspace((unsigned char)text[offset])) return false;
+        twists.push_back(twist);
+    }
+}
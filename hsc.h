@@ -0,0 +1,64 @@
+/**************************************************************************
+ * 3to4++ - https://github.com/rayzchen/3to4++
+ *-------------------------------------------------------------------------
+ * Copyright 2024 Ray Chen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ **************************************************************************/
+
+
+#ifndef HSC_H
+#define HSC_H
+
+#include <string>
+#include <vector>
+#include "state.h"
+
+// A Hyperspeedcube twist: a cell, a direction numbered for that cell and a
+// bitmask of the layers it turns, 7 being the whole puzzle
+struct HscTwist {
+    int cell;
+    int direction;
+    int layers;
+};
+
+// Translates between the moves of the physical puzzle and Hyperspeedcube
+// twists. Cell turns are single layer twists, while cell gyros and puzzle
+// rotations turn the whole puzzle. Slice gyros only set the physical puzzle
+// up for other moves, so they have no twist.
+class HscTranslator {
+    public:
+        // False for slice gyros
+        static bool getTwist(const MoveEntry& entry, HscTwist& twist);
+        // Turn, cell gyro or rotation for a twist, false if the physical
+        // puzzle has no such move
+        static bool getMove(const HscTwist& twist, MoveEntry& entry);
+        // Twists for moves, skipping slice gyros
+        static std::vector<HscTwist> toTwists(const std::vector<MoveEntry>& moves);
+        // Moves the physical puzzle plays for twists from state, slice gyros
+        // included, leaving state at the end. Returns the number of twists
+        // translated, which is short of the end at the first that has no
+        // move or cannot be played from where the puzzle is.
+        static size_t toMoves(const std::vector<HscTwist>& twists, PuzzleState& state, std::vector<MoveEntry>& moves);
+        // Twists separated by spaces, the way Hyperspeedcube logs them
+        static void appendTwists(std::string& text, const std::vector<HscTwist>& twists);
+        // False on anything but twists and whitespace
+        static bool parseTwists(const char *text, size_t length, std::vector<HscTwist>& twists);
+
+        // Turns the Hyperspeedcube puzzle to the way the physical puzzle is
+        // held, first in every scramble
+        static const HscTwist orientation;
+};
+
+#endif // hsc.h
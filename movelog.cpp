@@ -0,0 +1,209 @@
+/**************************************************************************
+ * 3to4++ - https://github.com/rayzchen/3to4++
+ *-------------------------------------------------------------------------
+ * Copyright 2024 Ray Chen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ **************************************************************************/
+
+
+#include "movelog.h"
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#define RYML_SINGLE_HDR_DEFINE_NOW
+#include <rapidyaml-0.6.0.hpp>
+
+static const char moveDigits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+
+// rapidyaml aborts on errors unless the callback leaves by throwing
+static void throwYamlError(const char *message, size_t length, ryml::Location location, void *data) {
+    throw std::runtime_error(std::string(message, length));
+}
+
+// Given to each parser rather than set globally, as logs are read from
+// several threads at once
+static const ryml::Callbacks& getYamlCallbacks() {
+    static const ryml::Callbacks callbacks(NULL, NULL, NULL, throwYamlError);
+    return callbacks;
+}
+
+static bool encodeMoves(const std::vector<MoveEntry>& entries, std::string& text) {
+    text.resize(entries.size());
+    for (size_t i = 0; i < entries.size(); i++) {
+        MoveCode move = PuzzleState::getMoveCode(entries[i]);
+        if (move == NUM_MOVES) return false;
+        text[i] = moveDigits[move];
+    }
+    return true;
+}
+
+// Entries for the moves played one after another from state, which is
+// left at the end
+static bool decodeMoves(ryml::csubstr text, PuzzleState& state, std::vector<MoveEntry>& entries) {
+    entries.reserve(text.len);
+    for (size_t i = 0; i < text.len; i++) {
+        const char *digit = std::strchr(moveDigits, text[i]);
+        if (digit == NULL || *digit == '\0') return false;
+        MoveCode move = digit - moveDigits;
+        entries.push_back(state.getMoveEntry(move));
+        state.applyMove(move);
+    }
+    return true;
+}
+
+static bool decodeTwists(ryml::ConstNodeRef node, std::vector<HscTwist>& twists) {
+    if (!node.has_val()) return false;
+    ryml::csubstr text = node.val();
+    return HscTranslator::parseTwists(text.str, text.len, twists);
+}
+
+bool MoveLog::read(std::string& text) {
+    scramble.clear();
+    moves.clear();
+    redo.clear();
+    bool valid = false;
+    try {
+        // Scalars point into the text, nothing is copied
+        ryml::Parser parser(getYamlCallbacks());
+        ryml::Tree tree = parser.parse_in_place(ryml::csubstr(), ryml::to_substr(text));
+        ryml::ConstNodeRef root = tree.crootref();
+        if (root.is_map() && root.has_child("version") && root.has_child("core") && root.has_child("state") &&
+            root.has_child("moves")) {
+            int version, coreVersion;
+            root["version"] >> version;
+            root["core"] >> coreVersion;
+            ryml::csubstr code = root["state"].val();
+            PuzzleState solved;
+            valid = version == LOG_VERSION && coreVersion == PUZZLE_CORE_VERSION &&
+                    start.decode(std::string(code.str, code.len)) &&
+                    (!root.has_child("scramble") || decodeMoves(root["scramble"].val(), solved, scramble));
+            // Redo plays on from where the moves leave off
+            PuzzleState state = start;
+            valid = valid && decodeMoves(root["moves"].val(), state, moves) &&
+                    (!root.has_child("redo") || decodeMoves(root["redo"].val(), state, redo));
+        }
+    } catch (const std::exception&) {
+        valid = false;
+    }
+    return valid;
+}
+
+bool MoveLog::write(const std::string& filename) const {
+    std::string scrambleText, movesText, redoText;
+    if (!encodeMoves(scramble, scrambleText) || !encodeMoves(moves, movesText) || !encodeMoves(redo, redoText)) {
+        return false;
+    }
+    ryml::Tree tree;
+    ryml::NodeRef root = tree.rootref();
+    root |= ryml::MAP;
+    root["version"] << LOG_VERSION;
+    root["core"] << PUZZLE_CORE_VERSION;
+    root["state"] << start.encode();
+    // The move strings are referenced, not copied into the tree
+    root["scramble"] = ryml::to_csubstr(scrambleText);
+    root["scramble"] |= ryml::VALQUO;
+    root["moves"] = ryml::to_csubstr(movesText);
+    root["moves"] |= ryml::VALQUO;
+    root["redo"] = ryml::to_csubstr(redoText);
+    root["redo"] |= ryml::VALQUO;
+
+    FILE *file = std::fopen(filename.c_str(), "wb");
+    if (file == NULL) return false;
+    ryml::emit_yaml(tree, file);
+    return std::fclose(file) == 0;
+}
+
+bool MoveLog::fromHsc(const HscLog& log) {
+    // Scrambles made by the program start by turning the puzzle the way
+    // the physical puzzle is held, a twist no move is written as
+    std::vector<HscTwist> twists = log.scramble;
+    if (twists.size() && twists[0].cell == HscTranslator::orientation.cell &&
+        twists[0].direction == HscTranslator::orientation.direction &&
+        twists[0].layers == HscTranslator::orientation.layers) {
+        twists.erase(twists.begin());
+    }
+    PuzzleState state;
+    scramble.clear();
+    moves.clear();
+    redo.clear();
+    if (HscTranslator::toMoves(twists, state, scramble) != twists.size()) return false;
+    start = state;
+    return HscTranslator::toMoves(log.twists, state, moves) == log.twists.size();
+}
+
+bool HscLog::read(std::string& text) {
+    scramble.clear();
+    twists.clear();
+    bool valid = false;
+    try {
+        ryml::Parser parser(getYamlCallbacks());
+        ryml::Tree tree = parser.parse_in_place(ryml::csubstr(), ryml::to_substr(text));
+        ryml::ConstNodeRef root = tree.crootref();
+        valid = root.is_map() && (root.has_child("scramble") || root.has_child("twists"));
+        if (valid && root.has_child("puzzle") && root["puzzle"].is_map()) {
+            ryml::ConstNodeRef puzzle = root["puzzle"];
+            int layers = 0;
+            if (puzzle.has_child("layer_count")) puzzle["layer_count"] >> layers;
+            valid = puzzle.has_child("type") && puzzle["type"].val() == "Rubiks4D" && layers == 3;
+        }
+        valid = valid && (!root.has_child("scramble") || decodeTwists(root["scramble"], scramble)) &&
+                (!root.has_child("twists") || decodeTwists(root["twists"], twists));
+    } catch (const std::exception&) {
+        valid = false;
+    }
+    return valid;
+}
+
+// Twist lists are written as folded scalars, like Hyperspeedcube does
+static void writeTwists(FILE *file, const char *key, const std::vector<HscTwist>& twists) {
+    std::string text;
+    HscTranslator::appendTwists(text, twists);
+    if (text.empty()) {
+        std::fprintf(file, "%s: ''\n", key);
+    } else {
+        std::fprintf(file, "%s: >\n  %s\n", key, text.c_str());
+    }
+}
+
+bool HscLog::write(const std::string& filename) const {
+    FILE *file = std::fopen(filename.c_str(), "wb");
+    if (file == NULL) return false;
+    std::fprintf(file, "version: 2\npuzzle:\n  type: Rubiks4D\n  layer_count: 3\n");
+    std::fprintf(file, "scramble_length: %lu\n", (unsigned long)scramble.size());
+    writeTwists(file, "scramble", scramble);
+    writeTwists(file, "twists", twists);
+    bool written = !std::ferror(file);
+    return std::fclose(file) == 0 && written;
+}
+
+bool HscLog::fromMoves(const MoveLog& log) {
+    // Scrambles are kept either as the moves picked or as the moves played
+    // for them, and playing each with its slice gyros covers both
+    PuzzleState state;
+    for (size_t i = 0; i < log.scramble.size(); i++) {
+        MoveCode move = PuzzleState::getMoveCode(log.scramble[i]);
+        if (move == NUM_MOVES) return false;
+        const std::vector<MoveEntry>& macro = PuzzleState::getMacro(state.config, move);
+        for (size_t j = 0; j < macro.size(); j++) {
+            state.applyMove(PuzzleState::getMoveCode(macro[j]));
+        }
+    }
+    if (state.stickers != log.start.stickers || state.config != log.start.config) return false;
+    scramble.assign(1, HscTranslator::orientation);
+    std::vector<HscTwist> scrambleTwists = HscTranslator::toTwists(log.scramble);
+    scramble.insert(scramble.end(), scrambleTwists.begin(), scrambleTwists.end());
+    twists = HscTranslator::toTwists(log.moves);
+    return true;
+}
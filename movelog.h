@@ -0,0 +1,67 @@
+/**************************************************************************
+ * 3to4++ - https://github.com/rayzchen/3to4++
+ *-------------------------------------------------------------------------
+ * Copyright 2024 Ray Chen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ **************************************************************************/
+
+
+#ifndef MOVELOG_H
+#define MOVELOG_H
+
+#include <string>
+#include <vector>
+#include "hsc.h"
+#include "state.h"
+
+// Log files are YAML maps. Move lists are strings of move codes, one base
+// 36 digit each, so a long log is a handful of scalars that are read in
+// place rather than a node per move.
+#define LOG_VERSION 1
+
+struct HscLog;
+
+// A history as saved by the program
+struct MoveLog {
+    // State before the first move
+    PuzzleState start;
+    std::vector<MoveEntry> scramble;
+    std::vector<MoveEntry> moves;
+    // Moves redo would play after them
+    std::vector<MoveEntry> redo;
+
+    // Parses text in place, so it is changed. False if it is not a log from
+    // this puzzle core version.
+    bool read(std::string& text);
+    // False if a move has no code or the file cannot be written
+    bool write(const std::string& filename) const;
+    // Plays the scramble and twists of a Hyperspeedcube log on the physical
+    // puzzle. False at the first twist it has no move for.
+    bool fromHsc(const HscLog& log);
+};
+
+// A Hyperspeedcube log of the 3x3x3x3
+struct HscLog {
+    std::vector<HscTwist> scramble;
+    std::vector<HscTwist> twists;
+
+    bool read(std::string& text);
+    bool write(const std::string& filename) const;
+    // False if the log starts from a state its scramble does not reach,
+    // as after a random state scramble
+    bool fromMoves(const MoveLog& log);
+};
+
+#endif // movelog.h
@@ -0,0 +1,345 @@
+/**************************************************************************
+ * 3to4++ - https://github.com/rayzchen/3to4++
+ *-------------------------------------------------------------------------
+ * Copyright 2024 Ray Chen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ **************************************************************************/
+
+
+#include "notation.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+static const char *cellLetters = "IORLUDFB";
+static const char *axisLetters = "xyz";
+
+// Index of c in letters, or -1
+static int findLetter(const char *letters, char c) {
+    const char *found = (c == '\0') ? NULL : strchr(letters, c);
+    return (found == NULL) ? -1 : found - letters;
+}
+
+struct NotationTables {
+    MoveCode inverses[NUM_MOVES];
+    std::string names[NUM_MOVES];
+    // Codes by letter, NUM_MOVES where the puzzle has no such move
+    MoveCode turns[8][3];
+    MoveCode gyros[8];
+    MoveCode rotations[3];
+    MoveCode outerGyro;
+    MoveCode middleGyro;
+    MoveCode middleFlip;
+
+    NotationTables() {
+        memset(turns, NUM_MOVES, sizeof(turns));
+        memset(gyros, NUM_MOVES, sizeof(gyros));
+        memset(rotations, NUM_MOVES, sizeof(rotations));
+        PuzzleState solved;
+        for (int move = 0; move < NUM_MOVES; move++) {
+            MoveEntry entry = solved.getMoveEntry(move);
+            std::string& name = names[move];
+            switch (entry.type) {
+                case TURN:
+                    if (entry.direction % 2 == 0) turns[entry.cell][entry.direction / 2] = move;
+                    name += cellLetters[entry.cell];
+                    name += axisLetters[entry.direction / 2];
+                    if (entry.direction % 2) name += '\'';
+                    entry.direction = (RotateDirection)(entry.direction ^ 1);
+                    break;
+                case GYRO:
+                    gyros[entry.cell] = move;
+                    name += cellLetters[entry.cell];
+                    name += 'g';
+                    // Gyros of opposite cells undo each other
+                    entry.cell = (CellLocation)(entry.cell ^ 1);
+                    break;
+                case ROTATE:
+                    if (entry.direction % 2 == 0) rotations[entry.direction / 2] = move;
+                    name += axisLetters[entry.direction / 2];
+                    if (entry.direction % 2) name += '\'';
+                    entry.direction = (RotateDirection)(entry.direction ^ 1);
+                    break;
+                case GYRO_OUTER:
+                    outerGyro = move;
+                    name = "G";
+                    break;
+                case GYRO_MIDDLE:
+                    if (entry.location == -1) middleGyro = move;
+                    if (entry.location == 0) middleFlip = move;
+                    name = (entry.location == 0) ? "N" : (entry.location < 0) ? "M" : "M'";
+                    entry.location = -entry.location;
+                    break;
+            }
+            inverses[move] = PuzzleState::getMoveCode(entry);
+        }
+    }
+};
+
+static const NotationTables& getTables() {
+    static NotationTables tables;
+    return tables;
+}
+
+// Recursive descent over the text, expanding into one move list as it
+// goes, so a group is only ever copied when it is repeated or inverted
+struct NotationParser {
+    const char *text;
+    size_t length;
+    size_t offset;
+    std::vector<MoveCode>& moves;
+    size_t errorOffset;
+    std::string error;
+
+    NotationParser(const char *text, size_t length, std::vector<MoveCode>& moves)
+        : text(text), length(length), offset(0), moves(moves), errorOffset(0) {}
+
+    bool fail(size_t at, const std::string& reason) {
+        errorOffset = at;
+        error = reason;
+        return false;
+    }
+
+    bool failUnexpected() {
+        if (offset == length) return fail(offset, "unexpected end");
+        unsigned char c = text[offset];
+        if (!isgraph(c)) return fail(offset, "unexpected character");
+        return fail(offset, std::string("unexpected '") + (char)c + "'");
+    }
+
+    void skipSpace() {
+        while (offset < length) {
+            if (text[offset] == '#') {
+                const void *newline = memchr(text + offset, '\n', length - offset);
+                offset = (newline == NULL) ? length : (const char*)newline - text;
+            } else if (isspace((unsigned char)text[offset])) {
+                offset++;
+            } else {
+                break;
+            }
+        }
+    }
+
+    // Room for count more moves
+    bool reserve(size_t count) {
+        if (count > NOTATION_MAX_MOVES - moves.size()) return fail(offset, "algorithm has too many moves");
+        return true;
+    }
+
+    void invert(size_t start) {
+        const NotationTables& tables = getTables();
+        std::reverse(moves.begin() + start, moves.end());
+        for (size_t i = start; i < moves.size(); i++) {
+            moves[i] = tables.inverses[moves[i]];
+        }
+    }
+
+    // Appends the inverse of the moves from start to end
+    bool appendInverse(size_t start, size_t end) {
+        if (!reserve(end - start)) return false;
+        size_t begin = moves.size();
+        moves.insert(moves.end(), moves.begin() + start, moves.begin() + end);
+        invert(begin);
+        return true;
+    }
+
+    // Plays the moves from start count times in all
+    bool repeat(size_t start, unsigned long long count) {
+        size_t size = moves.size() - start;
+        if (count == 0 || size == 0) {
+            moves.resize(start);
+            return true;
+        }
+        if (count - 1 > (NOTATION_MAX_MOVES - moves.size()) / size) {
+            return fail(offset, "algorithm has too many moves");
+        }
+        size_t end = moves.size();
+        moves.resize(start + size * count);
+        for (size_t i = end; i < moves.size(); i++) {
+            moves[i] = moves[i - size];
+        }
+        return true;
+    }
+
+    bool parseMove() {
+        const NotationTables& tables = getTables();
+        size_t start = offset;
+        char c = text[offset++];
+        int cell = findLetter(cellLetters, c);
+        int axis = findLetter(axisLetters, c);
+        MoveCode move;
+        if (cell >= 0) {
+            char next = (offset < length) ? text[offset] : '\0';
+            axis = findLetter(axisLetters, next);
+            if (axis >= 0) {
+                move = tables.turns[cell][axis];
+            } else if (next == 'g') {
+                move = tables.gyros[cell];
+            } else {
+                return fail(offset, std::string("expected x, y, z or g after ") + c);
+            }
+            offset++;
+        } else if (axis >= 0) {
+            move = tables.rotations[axis];
+        } else if (c == 'G') {
+            move = tables.outerGyro;
+        } else if (c == 'M') {
+            move = tables.middleGyro;
+        } else if (c == 'N') {
+            move = tables.middleFlip;
+        } else {
+            offset = start;
+            return failUnexpected();
+        }
+        if (move == NUM_MOVES) {
+            return fail(start, "the puzzle has no move " + std::string(text + start, offset - start));
+        }
+        if (!reserve(1)) return false;
+        moves.push_back(move);
+        return true;
+    }
+
+    // A count and a ' in either order
+    bool parseSuffix(size_t start) {
+        bool counted = false;
+        bool inverted = false;
+        unsigned long long count = 1;
+        while (offset < length) {
+            if (!counted && isdigit((unsigned char)text[offset])) {
+                count = 0;
+                while (offset < length && isdigit((unsigned char)text[offset])) {
+                    count = count * 10 + (text[offset++] - '0');
+                    if (count > NOTATION_MAX_MOVES) return fail(offset, "algorithm has too many moves");
+                }
+                counted = true;
+            } else if (!inverted && text[offset] == '\'') {
+                offset++;
+                inverted = true;
+            } else {
+                break;
+            }
+        }
+        if (inverted) invert(start);
+        return repeat(start, count);
+    }
+
+    bool expect(char c) {
+        skipSpace();
+        if (offset == length || text[offset] != c) {
+            return fail(offset, std::string("expected '") + c + "'");
+        }
+        offset++;
+        return true;
+    }
+
+    bool parseItem(int depth) {
+        size_t start = moves.size();
+        char c = text[offset];
+        if (c == '(' || c == '[') {
+            if (depth == NOTATION_MAX_DEPTH) return fail(offset, "groups are nested too deeply");
+            offset++;
+            if (!parseSequence(depth + 1)) return false;
+            if (c == '(') {
+                if (!expect(')')) return false;
+            } else {
+                size_t middle = moves.size();
+                skipSpace();
+                char separator = (offset < length) ? text[offset] : '\0';
+                if (separator != ',' && separator != ':') return fail(offset, "expected ',' or ':'");
+                offset++;
+                if (!parseSequence(depth + 1) || !expect(']')) return false;
+                size_t end = moves.size();
+                if (!appendInverse(start, middle)) return false;
+                if (separator == ',' && !appendInverse(middle, end)) return false;
+            }
+        } else if (!parseMove()) {
+            return false;
+        }
+        return parseSuffix(start);
+    }
+
+    // Items up to the end of the text or of the group
+    bool parseSequence(int depth) {
+        while (true) {
+            skipSpace();
+            if (offset == length || findLetter(")],:", text[offset]) >= 0) return true;
+            if (!parseItem(depth)) return false;
+        }
+    }
+
+    bool parse() {
+        if (!parseSequence(0)) return false;
+        if (offset < length) return failUnexpected();
+        return true;
+    }
+};
+
+bool Notation::parse(const char *text, size_t length, std::vector<MoveCode>& moves, size_t& errorOffset, std::string& error) {
+    moves.clear();
+    NotationParser parser(text, length, moves);
+    if (parser.parse()) return true;
+    errorOffset = parser.errorOffset;
+    error = parser.error;
+    return false;
+}
+
+MoveCode Notation::getInverse(MoveCode move) {
+    return getTables().inverses[move];
+}
+
+void Notation::appendMoves(std::string& text, const std::vector<MoveCode>& moves) {
+    const NotationTables& tables = getTables();
+    text.reserve(text.size() + moves.size() * 4);
+    for (size_t i = 0; i < moves.size(); i++) {
+        if (i > 0) text += ' ';
+        text += tables.names[moves[i]];
+    }
+}
+
+// Turns and gyros bring their own slice gyros along, but the others only
+// play where the slices allow them
+static bool canPlay(const PuzzleState& state, MoveCode move) {
+    return move < MOVE_GYRO_OUTER || ((PuzzleState::getLegalMoves(state.config) >> move) & 1);
+}
+
+size_t Notation::toEntries(const std::vector<MoveCode>& moves, PuzzleState& state, std::vector<MoveEntry>& entries) {
+    for (size_t i = 0; i < moves.size(); i++) {
+        if (!canPlay(state, moves[i])) return i;
+        const std::vector<MoveEntry>& macro = PuzzleState::getMacro(state.config, moves[i]);
+        if (macro.empty()) return i;
+        for (size_t j = 0; j < macro.size(); j++) {
+            entries.push_back(macro[j]);
+            state.applyMove(PuzzleState::getMoveCode(macro[j]));
+        }
+    }
+    return moves.size();
+}
+
+size_t Notation::apply(const std::vector<MoveCode>& moves, PuzzleState& state) {
+    for (size_t i = 0; i < moves.size(); i++) {
+        if (!canPlay(state, moves[i])) return i;
+        if (moves[i] >= MOVE_GYRO_OUTER) {
+            state.applyMove(moves[i]);
+            continue;
+        }
+        // Codes straight from the tables, without looking entries up
+        const std::vector<MoveCode>& codes = state.expandMove(moves[i]);
+        if (codes.empty()) return i;
+        for (size_t j = 0; j < codes.size(); j++) {
+            state.applyMove(codes[j]);
+        }
+    }
+    return moves.size();
+}
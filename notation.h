@@ -0,0 +1,67 @@
+/**************************************************************************
+ * 3to4++ - https://github.com/rayzchen/3to4++
+ *-------------------------------------------------------------------------
+ * Copyright 2024 Ray Chen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ **************************************************************************/
+
+
+#ifndef NOTATION_H
+#define NOTATION_H
+
+#include <string>
+#include <vector>
+#include "state.h"
+
+// Algorithms are written with the cell letters of the help text, I, O, R,
+// L, U, D, F and B, and the rotation axes x, y and z:
+//   Rx   cell turn, x' turning the other way
+//   Rg   cell gyro
+//   x    puzzle rotation
+//   G    outer slice gyro
+//   M    middle slice gyro, M' the other way
+//   N    middle slice flip
+// Any move or group may be followed by a count and a ' to invert it, in
+// either order. Groups are (A B), commutators [A, B] for A B A' B' and
+// conjugates [A: B] for A B A'. Whitespace is optional and # starts a
+// comment running to the end of the line.
+
+// Moves after expanding groups and counts, above which parsing fails
+#define NOTATION_MAX_MOVES 16777216
+// Groups nested deeper fail to parse
+#define NOTATION_MAX_DEPTH 256
+
+// Parses algorithms into move codes and plays them on the physical puzzle
+class Notation {
+    public:
+        // Moves of an algorithm with every group and count expanded. False
+        // on a syntax error or a move the physical puzzle does not have,
+        // with the offset in the text and what went wrong.
+        static bool parse(const char *text, size_t length, std::vector<MoveCode>& moves, size_t& errorOffset, std::string& error);
+        // Move undoing a move, slice config included
+        static MoveCode getInverse(MoveCode move);
+        // Moves as the notation writes them, separated by spaces
+        static void appendMoves(std::string& text, const std::vector<MoveCode>& moves);
+        // Entries the controller plays for moves from state, slice gyros
+        // included, leaving state at the end. Returns the number of moves
+        // compiled, which is short of the end at the first that cannot be
+        // played from where the puzzle is.
+        static size_t toEntries(const std::vector<MoveCode>& moves, PuzzleState& state, std::vector<MoveEntry>& entries);
+        // Plays moves on state the same way, which leaves the permutation
+        // of the whole algorithm in its stickers
+        static size_t apply(const std::vector<MoveCode>& moves, PuzzleState& state);
+};
+
+#endif // notation.h
@@ -522,3 +522,128 @@ void Puzzle::rotatePuzzle(RotateDirection direction) {
 
     gyroMiddleSlice(0);
 }
+
+void Puzzle::applyMove(MoveEntry entry) {
+    switch (entry.type) {
+        case TURN: rotateCell(entry.cell, entry.direction); break;
+        case ROTATE: rotatePuzzle(entry.direction); break;
+        case GYRO: gyroCell(entry.cell); break;
+        case GYRO_OUTER: gyroOuterSlice(); break;
+        case GYRO_MIDDLE: gyroMiddleSlice(entry.location); break;
+    }
+}
+
+void Puzzle::expandGyro(CellLocation cell, std::vector<MoveEntry>& macro) const {
+    MoveEntry entry;
+    int direction = 0;
+    switch (cell) {
+        case LEFT:
+        case RIGHT:
+            entry.type = GYRO;
+            entry.animLength = 4.0f;
+            entry.cell = cell;
+            macro.push_back(entry);
+            break;
+        case UP:
+        case DOWN:
+            if (middleSliceDir == FRONT) {
+                entry.type = GYRO_MIDDLE;
+                entry.animLength = 1.0f;
+                entry.location = 0;
+                macro.push_back(entry);
+            }
+
+            if (middleSlicePos == 0) {
+                direction = outerSlicePos;
+            } else if (middleSlicePos == 2 * outerSlicePos) {
+                direction = -outerSlicePos;
+            } else if (middleSlicePos == -outerSlicePos) {
+                entry.type = GYRO_OUTER;
+                entry.animLength = 2.0f;
+                entry.location = -1 * outerSlicePos;
+                macro.push_back(entry);
+                direction = 0;
+            } else if (middleSlicePos == outerSlicePos) {
+                direction = 0;
+            }
+
+            if (direction != 0) {
+                entry.type = GYRO_MIDDLE;
+                entry.animLength = 1.0f;
+                entry.location = direction;
+                macro.push_back(entry);
+            }
+
+            entry.type = GYRO;
+            entry.animLength = 3.0f;
+            entry.cell = cell;
+            macro.push_back(entry);
+            break;
+        case FRONT:
+        case BACK:
+            if (middleSliceDir == UP) {
+                entry.type = GYRO_MIDDLE;
+                entry.animLength = 1.0f;
+                entry.location = 0;
+                macro.push_back(entry);
+            }
+
+            if (middleSlicePos == 0) {
+                direction = outerSlicePos;
+            } else if (middleSlicePos == 2 * outerSlicePos) {
+                direction = -outerSlicePos;
+            } else if (middleSlicePos == -outerSlicePos) {
+                entry.type = GYRO_OUTER;
+                entry.animLength = 2.0f;
+                entry.location = -1 * outerSlicePos;
+                macro.push_back(entry);
+                direction = 0;
+            } else if (middleSlicePos == outerSlicePos) {
+                direction = 0;
+            }
+
+            if (direction != 0) {
+                entry.type = GYRO_MIDDLE;
+                entry.animLength = 1.0f;
+                entry.location = direction;
+                macro.push_back(entry);
+            }
+
+            entry.type = GYRO;
+            entry.animLength = 3.0f;
+            entry.cell = cell;
+            macro.push_back(entry);
+            break;
+        case IN:
+        case OUT:
+            break;
+    }
+}
+
+void Puzzle::expandCellMove(CellLocation cell, RotateDirection direction, std::vector<MoveEntry>& moves) const {
+    MoveEntry entry;
+    if ((cell == UP || cell == DOWN) && middleSliceDir == FRONT) {
+        entry.type = GYRO_MIDDLE;
+        entry.animLength = 1.0f;
+        entry.location = 0;
+        moves.push_back(entry);
+    } else if ((cell == FRONT || cell == BACK) && middleSliceDir == UP) {
+        entry.type = GYRO_MIDDLE;
+        entry.animLength = 1.0f;
+        entry.location = 0;
+        moves.push_back(entry);
+    }
+
+    float length;
+    if (cell == UP || cell == DOWN || cell == FRONT || cell == BACK) {
+        length = 2.0f;
+    } else {
+        length = 1.0f;
+    }
+
+    entry.type = TURN;
+    entry.animLength = length;
+    entry.cell = cell;
+    entry.direction = direction;
+    moves.push_back(entry);
+}
@@ -38,6 +38,18 @@ typedef enum : int {
     ZY, YZ, XZ, ZX, YX, XY
 } RotateDirection;
 
+typedef enum {
+    GYRO, TURN, ROTATE, GYRO_OUTER, GYRO_MIDDLE
+} MoveType;
+
+struct MoveEntry {
+    MoveType type;
+    float animLength;
+    CellLocation cell; // for GYRO, TURN
+    RotateDirection direction; // for TURN
+    int location; // for slice gyros (-1/0/1 for middle gyros)
+};
+
 typedef struct {
     // Unused depending on piece type
     Color a;
@@ -52,6 +64,7 @@ typedef std::array<SliceData, 3> CellData;
 class Puzzle {
     friend class PuzzleRenderer;
     friend class PuzzleController;
+    friend class PuzzleState;
     public:
         static std::array<Color, 8> scheme;
         Puzzle();
@@ -64,6 +77,10 @@ class Puzzle {
         void gyroMiddleSlice(int direction);
         bool canRotatePuzzle(RotateDirection direction);
         void rotatePuzzle(RotateDirection direction);
+        void applyMove(MoveEntry entry);
+        // Slice gyros needed before a gyro or cell turn, then the move itself
+        void expandGyro(CellLocation cell, std::vector<MoveEntry>& macro) const;
+        void expandCellMove(CellLocation cell, RotateDirection direction, std::vector<MoveEntry>& moves) const;
 
     private:
         // [x][y][z]
@@ -159,6 +159,7 @@ PuzzleRenderer::PuzzleRenderer(Puzzle *puzzle) {
     animating = false;
     animationProgress = 0.0f;
     animationSpeed = 4.0f;
+    hiddenRegions = 0;
     mat4x4_identity(model);
 
     meshes[0] = new PieceMesh(Pieces::mesh1c);
@@ -314,14 +315,14 @@ bool checkFilter(std::array<int, 3> filter, std::array<int, 3> pos) {
 }
 
 void PuzzleRenderer::renderCell(Shader *shader, const std::array<std::array<std::array<Piece, 3>, 3>, 3>& cell, float offset, std::array<int, 3> sliceFilter) {
-    if (checkFilter(sliceFilter, {0, 0, 0})) {
+    if (checkFilter(sliceFilter, {0, 0, 0}) && !isHidden(cell[1])) {
         render1c(shader, {offset, 0, 0}, cell[1][1][1].a);
     }
     for (int i = 0; i < 3; i++) {
         for (int j = 0; j < 2; j++) {
             std::array<int, 3> pos = {0, 0, 0};
             pos[i] += j * -2 + 1;
-            if (checkFilter(sliceFilter, pos)) {
+            if (checkFilter(sliceFilter, pos) && !isHidden(cell[pos[0] + 1])) {
                 Piece piece = cell[pos[0] + 1][pos[1] + 1][pos[2] + 1];
                 CellLocation orientation = (CellLocation)(i * 2 + j + 2);
                 render2c(shader, {(float)pos[0] + offset, (float)pos[1], (float)pos[2]}, {piece.a, piece.b}, orientation);
@@ -335,7 +336,7 @@ void PuzzleRenderer::renderCell(Shader *shader, const std::array<std::array<std:
                 std::array<int, 3> pos = {0, 0, 0};
                 pos[i] = k * -2 + 1;
                 pos[(i + 1) % 3] = j * -2 + 1;
-                if (checkFilter(sliceFilter, pos)) {
+                if (checkFilter(sliceFilter, pos) && !isHidden(cell[pos[0] + 1])) {
                     Piece piece = cell[pos[0] + 1][pos[1] + 1][pos[2] + 1];
                     render3c(shader, {(float)pos[0] + offset, (float)pos[1], (float)pos[2]}, {piece.a, piece.b, piece.c});
                 }
@@ -348,7 +349,7 @@ void PuzzleRenderer::renderCell(Shader *shader, const std::array<std::array<std:
             for (int k = 0; k < 2; k++) {
                 std::array<int, 3> pos = {i * -2 + 1, j * -2 + 1, k * -2 + 1};
                 int orientation = (i + k) + 2*i*(1 - k);
-                if (checkFilter(sliceFilter, pos)) {
+                if (checkFilter(sliceFilter, pos) && !isHidden(cell[pos[0] + 1])) {
                     Piece piece = cell[pos[0] + 1][pos[1] + 1][pos[2] + 1];
                     render4c(shader, {(float)pos[0] + offset, (float)pos[1], (float)pos[2]}, {piece.a, piece.b, piece.c, piece.d}, 4*j + orientation);
                 }
@@ -358,6 +359,7 @@ void PuzzleRenderer::renderCell(Shader *shader, const std::array<std::array<std:
 }
 
 void PuzzleRenderer::renderSlice(Shader *shader, const std::array<std::array<Piece, 3>, 3>& slice, float offset, std::array<int, 2> stripFilter) {
+    if (isHidden(slice)) return;
     if (checkFilter(stripFilter, {0, 0})) {
         render1c(shader, {offset, 0, 0}, slice[1][1].a);
     }
@@ -387,6 +389,7 @@ void PuzzleRenderer::renderSlice(Shader *shader, const std::array<std::array<Pie
 }
 
 void PuzzleRenderer::renderMiddleSlice(Shader *shader, bool addOffsetX, float offsetYZ, CellLocation filter) {
+    if (hiddenRegions & REGION_MIDDLE) return;
     float offset = (addOffsetX ? -0.5 * puzzle->outerSlicePos : 0.0f) + 2 * puzzle->middleSlicePos;
     if (filter == UP || filter == (CellLocation)-1) {
         render1c(shader, {offset, 2 + offsetYZ, 0}, puzzle->topCell.a);
@@ -426,8 +429,29 @@ void PuzzleRenderer::renderPuzzle(Shader *shader) {
     glLineWidth(2);
     if (pendingMoves.size() == 0) {
         renderNoAnimation(shader);
-    } else if (pendingMoves.front().type == TURN) {
-        MoveEntry move = pendingMoves.front();
+        return;
+    }
+
+    // First move draws everything not owned by the other running moves
+    std::vector<unsigned int> regions = getPendingRegions();
+    hiddenRegions = 0;
+    for (size_t i = 1; i < pendingMoves.size(); i++) {
+        if (pendingMoves[i].started) hiddenRegions |= regions[i];
+    }
+    animationProgress = pendingMoves[0].progress;
+    renderMoveAnimation(shader, pendingMoves[0].entry);
+
+    for (size_t i = 1; i < pendingMoves.size(); i++) {
+        if (!pendingMoves[i].started) continue;
+        hiddenRegions = REGION_ALL & ~regions[i];
+        animationProgress = pendingMoves[i].progress;
+        renderMoveAnimation(shader, pendingMoves[i].entry);
+    }
+    hiddenRegions = 0;
+}
+
+void PuzzleRenderer::renderMoveAnimation(Shader *shader, MoveEntry move) {
+    if (move.type == TURN) {
         switch (move.cell) {
             case LEFT: renderLeftAnimation(shader, move.direction); break;
             case RIGHT: renderRightAnimation(shader, move.direction); break;
@@ -438,10 +462,9 @@ void PuzzleRenderer::renderPuzzle(Shader *shader) {
             case UP: renderUpDownAnimation(shader, UP, move.direction); break;
             case DOWN: renderUpDownAnimation(shader, DOWN, move.direction); break;
         }
-    } else if (pendingMoves.front().type == ROTATE) {
-        renderRotateAnimation(shader, pendingMoves.front().direction);
-    } else if (pendingMoves.front().type == GYRO) {
-        MoveEntry move = pendingMoves.front();
+    } else if (move.type == ROTATE) {
+        renderRotateAnimation(shader, move.direction);
+    } else if (move.type == GYRO) {
         switch (move.cell) {
             case LEFT:
             case RIGHT:
@@ -458,10 +481,10 @@ void PuzzleRenderer::renderPuzzle(Shader *shader) {
             default:
                 return;
         }
-    } else if (pendingMoves.front().type == GYRO_OUTER) {
-        renderOuterGyroAnimation(shader, pendingMoves.front().location);
-    } else if (pendingMoves.front().type == GYRO_MIDDLE) {
-        renderPGyroAnimation(shader, pendingMoves.front().location);
+    } else if (move.type == GYRO_OUTER) {
+        renderOuterGyroAnimation(shader, move.location);
+    } else if (move.type == GYRO_MIDDLE) {
+        renderPGyroAnimation(shader, move.location);
     }
 }
 
@@ -1128,28 +1151,135 @@ void PuzzleRenderer::renderPGyroPosAnimation(Shader *shader, int direction) {
     }
 }
 
-bool PuzzleRenderer::updateAnimations(GLFWwindow* window, double dt, MoveEntry *entry) {
+bool PuzzleRenderer::updateAnimations(GLFWwindow* window, double dt, MoveEntry *entry, double *time) {
     if (pendingMoves.size() == 0) {
         animating = false;
     }
     if (animating) {
-        animationProgress += dt * animationSpeed;
-        if (animationProgress > pendingMoves.front().animLength) {
-            MoveEntry lastEntry = pendingMoves.front();
-            pendingMoves.pop();
-            animationProgress = 0.0f;
-            *entry = lastEntry;
+        startIndependentMoves();
+        for (size_t i = 0; i < pendingMoves.size(); i++) {
+            if (!pendingMoves[i].started) continue;
+            pendingMoves[i].progress += dt * animationSpeed * pendingMoves[i].speed;
+            if (i != 0) {
+                // Hold finished moves until the moves before them are committed
+                pendingMoves[i].progress = std::min(pendingMoves[i].progress, pendingMoves[i].entry.animLength);
+            }
+        }
+        if (pendingMoves.front().progress >= pendingMoves.front().entry.animLength) {
+            PendingMove finished = pendingMoves.front();
+            pendingMoves.pop_front();
+            *entry = finished.entry;
+            *time = finished.time;
+            if (pendingMoves.size() && pendingMoves.front().chained && !pendingMoves.front().started) {
+                // Hand leftover time to the next move in the sequence
+                float overshoot = (finished.progress - finished.entry.animLength) / finished.speed;
+                pendingMoves.front().started = true;
+                pendingMoves.front().progress = overshoot * pendingMoves.front().speed;
+            }
             return true;
         }
     }
     return false;
 }
 
+void PuzzleRenderer::startIndependentMoves() {
+    std::vector<unsigned int> regions = getPendingRegions();
+    unsigned int blocked = 0;
+    for (size_t i = 0; i < pendingMoves.size(); i++) {
+        if (!pendingMoves[i].started && (i == 0 || !(regions[i] & blocked))) {
+            pendingMoves[i].started = true;
+            pendingMoves[i].progress = 0.0f;
+        }
+        blocked |= regions[i];
+    }
+}
+
 void PuzzleRenderer::scheduleMove(MoveEntry entry) {
-    pendingMoves.push(entry);
+    PendingMove move;
+    move.entry = entry;
+    move.progress = 0.0f;
+    move.speed = 1.0f;
+    move.chained = false;
+    move.started = false;
+    move.time = glfwGetTime();
+    pendingMoves.push_back(move);
     animating = true;
 }
 
+void PuzzleRenderer::scheduleSequence(std::vector<MoveEntry> entries, float maxLength) {
+    float totalLength = 0.0f;
+    for (size_t i = 0; i < entries.size(); i++) {
+        totalLength += entries[i].animLength;
+    }
+    float speed = std::max(1.0f, totalLength / maxLength);
+    double time = glfwGetTime();
+    for (size_t i = 0; i < entries.size(); i++) {
+        scheduleMove(entries[i]);
+        pendingMoves.back().speed = speed;
+        pendingMoves.back().chained = (i != 0);
+        pendingMoves.back().time = time;
+    }
+}
+
+void PuzzleRenderer::clearMoves() {
+    pendingMoves.clear();
+    animating = false;
+}
+
+unsigned int PuzzleRenderer::getMiddleNeighbour(int position) {
+    // Region sitting next to the middle slice at this position
+    if (position == 0) return REGION_INNER;
+    if (position == 1) return REGION_RIGHT << 1;
+    if (position == -1) return REGION_LEFT << 1;
+    return REGION_OUTER;
+}
+
+unsigned int PuzzleRenderer::getMoveRegions(MoveEntry entry, int middleSlicePos) {
+    // Only moves that leave the rest of the puzzle in place can share
+    // the screen, everything else claims the whole puzzle
+    if (entry.type == TURN && entry.cell == IN) {
+        unsigned int regions = (REGION_LEFT << 2) | REGION_INNER | REGION_RIGHT;
+        if (middleSlicePos == 0) regions |= REGION_MIDDLE;
+        return regions;
+    } else if (entry.type == TURN && entry.cell == OUT) {
+        unsigned int regions = REGION_LEFT | REGION_OUTER | (REGION_RIGHT << 2);
+        if (middleSlicePos == 2 * puzzle->outerSlicePos) regions |= REGION_MIDDLE;
+        return regions;
+    } else if (entry.type == GYRO_MIDDLE) {
+        return REGION_MIDDLE | getMiddleNeighbour(middleSlicePos) |
+            getMiddleNeighbour(middleSlicePos + entry.location);
+    }
+    return REGION_ALL;
+}
+
+std::vector<unsigned int> PuzzleRenderer::getPendingRegions() {
+    // Each move starts from the slice position the middle slice gyros
+    // queued before it leave, not the committed one. Outer slice gyros
+    // claim the whole puzzle, so nothing after one runs before it is
+    // committed.
+    std::vector<unsigned int> regions(pendingMoves.size());
+    int middleSlicePos = puzzle->middleSlicePos;
+    for (size_t i = 0; i < pendingMoves.size(); i++) {
+        regions[i] = getMoveRegions(pendingMoves[i].entry, middleSlicePos);
+        if (pendingMoves[i].entry.type == GYRO_MIDDLE) middleSlicePos += pendingMoves[i].entry.location;
+    }
+    return regions;
+}
+
+unsigned int PuzzleRenderer::getSliceRegion(const SliceData& slice) {
+    if (&slice == &puzzle->innerSlice) return REGION_INNER;
+    if (&slice == &puzzle->outerSlice) return REGION_OUTER;
+    for (int i = 0; i < 3; i++) {
+        if (&slice == &puzzle->leftCell[i]) return REGION_LEFT << i;
+        if (&slice == &puzzle->rightCell[i]) return REGION_RIGHT << i;
+    }
+    return 0;
+}
+
+bool PuzzleRenderer::isHidden(const SliceData& slice) {
+    return hiddenRegions != 0 && (hiddenRegions & getSliceRegion(slice));
+}
+
 void PuzzleRenderer::renderCellOutline(Shader *shader, CellLocation cell) {
     if (animating) return;
     shader->use();
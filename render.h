@@ -23,7 +23,7 @@
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 #include <linmath.h>
-#include <queue>
+#include <deque>
 #include <array>
 #include <vector>
 #include "pieces.h"
@@ -56,18 +56,28 @@ class PieceMesh {
         std::vector<float> normals;
 };
 
-typedef enum {
-    GYRO, TURN, ROTATE, GYRO_OUTER, GYRO_MIDDLE
-} MoveType;
-
-struct MoveEntry {
-    MoveType type;
-    float animLength;
-    CellLocation cell; // for GYRO, TURN
-    RotateDirection direction; // for TURN
-    int location; // for slice gyros (-1/0/1 for middle gyros)
+struct PendingMove {
+    MoveEntry entry;
+    float progress;
+    float speed; // multiplier on animationSpeed
+    bool chained; // carries on from the previous move without a pause
+    bool started;
+    // Monotonic seconds when the move was input, the same for a whole
+    // sequence
+    double time;
 };
 
+// Groups of pieces that an animation can move. Queued moves whose regions
+// do not overlap are animated at the same time.
+typedef enum : unsigned int {
+    REGION_LEFT = 1, // leftCell[x] uses REGION_LEFT << x
+    REGION_RIGHT = 1 << 3, // rightCell[x] uses REGION_RIGHT << x
+    REGION_INNER = 1 << 6,
+    REGION_OUTER = 1 << 7,
+    REGION_MIDDLE = 1 << 8,
+    REGION_ALL = (1 << 9) - 1
+} PuzzleRegion;
+
 class PuzzleRenderer {
     public:
         friend class PuzzleController;
@@ -87,8 +97,15 @@ class PuzzleRenderer {
         void renderCellOutline(Shader *shader, CellLocation cell);
         void setMousePressed(bool pressed);
         bool updateMouse(GLFWwindow* window, double dt);
-        bool updateAnimations(GLFWwindow *window, double dt, MoveEntry* entry);
+        // Hands out the next finished move and when it was input
+        bool updateAnimations(GLFWwindow *window, double dt, MoveEntry* entry, double* time);
         void scheduleMove(MoveEntry entry);
+        // Plays the entries one after another without pausing, sped up
+        // together so they take no longer than maxLength
+        void scheduleSequence(std::vector<MoveEntry> entries, float maxLength);
+        void clearMoves();
+        // Regions the move animates, for the middle slice at middleSlicePos
+        unsigned int getMoveRegions(MoveEntry entry, int middleSlicePos);
 
     private:
         Puzzle *puzzle;
@@ -99,11 +116,20 @@ class PuzzleRenderer {
         float sensitivity;
         float lastY;
         mat4x4 model;
-        std::queue<MoveEntry> pendingMoves;
+        std::deque<PendingMove> pendingMoves;
         bool animating;
         float animationSpeed;
         float animationProgress;
+        unsigned int hiddenRegions;
 
+        void startIndependentMoves();
+        // Regions of each pending move, from where the moves before it
+        // leave the middle slice
+        std::vector<unsigned int> getPendingRegions();
+        unsigned int getSliceRegion(const SliceData& slice);
+        unsigned int getMiddleNeighbour(int position);
+        bool isHidden(const SliceData& slice);
+        void renderMoveAnimation(Shader *shader, MoveEntry move);
         void renderNoAnimation(Shader *shader);
         void renderLeftAnimation(Shader *shader, RotateDirection direction);
         void renderRightAnimation(Shader *shader, RotateDirection direction);
@@ -0,0 +1,445 @@
+/**************************************************************************
+ * 3to4++ - https://github.com/rayzchen/3to4++
+ *-------------------------------------------------------------------------
+ * Copyright 2024 Ray Chen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ **************************************************************************/
+
+#include "scrambler.h"
+#include "hsc.h"
+#include <algorithm>
+#include <climits>
+#include <map>
+#include <sstream>
+
+static unsigned long long mix64(unsigned long long z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+SplitMix64::SplitMix64(unsigned long long seed, unsigned long long stream) {
+    key = mix64(mix64(seed + 0x9e3779b97f4a7c15ULL) ^ stream);
+    counter = 0;
+}
+
+SplitMix64::result_type SplitMix64::operator()() {
+    return mix64(key + ++counter * 0x9e3779b97f4a7c15ULL);
+}
+
+// Permutations act like states: (a * b)[i] = a[b[i]] applies a, then b
+static StickerPermutation compose(const StickerPermutation& a, const StickerPermutation& b) {
+    StickerPermutation result;
+    for (int i = 0; i < NUM_STICKERS; i++) {
+        result[i] = a[b[i]];
+    }
+    return result;
+}
+
+static StickerPermutation invert(const StickerPermutation& perm) {
+    StickerPermutation result;
+    for (int i = 0; i < NUM_STICKERS; i++) {
+        result[perm[i]] = i;
+    }
+    return result;
+}
+
+static StickerPermutation identity() {
+    StickerPermutation result;
+    for (int i = 0; i < NUM_STICKERS; i++) {
+        result[i] = i;
+    }
+    return result;
+}
+
+static bool isIdentity(const StickerPermutation& perm) {
+    for (int i = 0; i < NUM_STICKERS; i++) {
+        if (perm[i] != i) return false;
+    }
+    return true;
+}
+
+std::vector<StickerPermutation> Scrambler::getMoveGenerators() {
+    std::vector<StickerPermutation> generators;
+    for (int move = 0; move < NUM_MOVES; move++) {
+        StickerPermutation perm;
+        const unsigned char *table = PuzzleState::getMovePermutation(move);
+        std::copy(table, table + NUM_STICKERS, perm.begin());
+        if (!isIdentity(perm)) generators.push_back(perm);
+    }
+    return generators;
+}
+
+Scrambler::Scrambler() : Scrambler(getMoveGenerators()) {}
+
+Scrambler::Scrambler(const std::vector<StickerPermutation>& generators) {
+    for (size_t i = 0; i < generators.size(); i++) {
+        addGenerator(generators[i]);
+    }
+    if (levels.empty()) return;
+
+    // Product replacement gives close to uniform random elements once mixed.
+    // Small generating sets are repeated to give the pool room to mix.
+    std::mt19937 rng;
+    std::vector<StickerPermutation> pool(generators);
+    for (size_t i = 0; pool.size() < 10; i++) {
+        pool.push_back(generators[i % generators.size()]);
+    }
+    StickerPermutation accumulator = identity();
+    int successes = 0;
+    for (int i = 0; successes < 64; i++) {
+        int a = rng() % pool.size();
+        int b = rng() % (pool.size() - 1);
+        if (b >= a) b++;
+        if (rng() % 2) {
+            pool[a] = compose(pool[a], pool[b]);
+        } else {
+            pool[a] = compose(pool[b], pool[a]);
+        }
+        accumulator = compose(accumulator, pool[a]);
+        if (i < 100) continue;
+
+        StickerPermutation residue = accumulator;
+        sift(residue);
+        if (isIdentity(residue)) {
+            successes++;
+        } else {
+            successes = 0;
+            addGenerator(accumulator);
+        }
+    }
+}
+
+size_t Scrambler::sift(StickerPermutation& perm) const {
+    for (size_t i = 0; i < levels.size(); i++) {
+        int index = levels[i].orbitIndex[perm[levels[i].point]];
+        if (index < 0) return i;
+        perm = compose(levels[i].inverses[index], perm);
+    }
+    return levels.size();
+}
+
+void Scrambler::addGenerator(StickerPermutation perm) {
+    size_t depth = sift(perm);
+    if (isIdentity(perm)) return;
+    if (depth == levels.size()) {
+        Level level;
+        level.point = 0;
+        while (perm[level.point] == level.point) level.point++;
+        levels.push_back(level);
+    }
+    // The residue fixes every earlier base point
+    for (size_t i = 0; i <= depth; i++) {
+        levels[i].generators.push_back(perm);
+        buildOrbit(levels[i]);
+    }
+}
+
+void Scrambler::buildOrbit(Level& level) {
+    level.orbit.assign(1, level.point);
+    level.orbitIndex.fill(-1);
+    level.orbitIndex[level.point] = 0;
+    level.transversal.assign(1, identity());
+    for (size_t i = 0; i < level.orbit.size(); i++) {
+        for (size_t j = 0; j < level.generators.size(); j++) {
+            int image = level.generators[j][level.orbit[i]];
+            if (level.orbitIndex[image] >= 0) continue;
+            level.orbitIndex[image] = level.orbit.size();
+            level.orbit.push_back(image);
+            level.transversal.push_back(compose(level.generators[j], level.transversal[i]));
+        }
+    }
+    level.inverses.resize(level.transversal.size());
+    for (size_t i = 0; i < level.transversal.size(); i++) {
+        level.inverses[i] = invert(level.transversal[i]);
+    }
+}
+
+bool Scrambler::isReachable(const PuzzleState& state) const {
+    StickerPermutation perm = state.stickers;
+    sift(perm);
+    return isIdentity(perm);
+}
+
+std::string Scrambler::getGroupOrder() const {
+    // Little endian base 10^9
+    std::vector<unsigned int> order(1, 1);
+    for (size_t i = 0; i < levels.size(); i++) {
+        unsigned long long carry = 0;
+        for (size_t j = 0; j < order.size(); j++) {
+            carry += (unsigned long long)order[j] * levels[i].orbit.size();
+            order[j] = carry % 1000000000;
+            carry /= 1000000000;
+        }
+        if (carry) order.push_back(carry);
+    }
+    std::string result = std::to_string(order.back());
+    for (size_t i = order.size() - 1; i-- > 0;) {
+        std::string digits = std::to_string(order[i]);
+        result += std::string(9 - digits.size(), '0') + digits;
+    }
+    return result;
+}
+
+bool Scrambler::getGroupOrder(unsigned long long& order) const {
+    order = 1;
+    for (size_t i = 0; i < levels.size(); i++) {
+        if (order > ~0ULL / levels[i].orbit.size()) return false;
+        order *= levels[i].orbit.size();
+    }
+    return true;
+}
+
+unsigned long long Scrambler::getProductIndex(unsigned long long index, const StickerPermutation& perm) const {
+    // The element is the product of one representative per level, as in
+    // randomState
+    std::vector<int> indices(levels.size());
+    for (size_t i = levels.size(); i-- > 0;) {
+        indices[i] = index % levels[i].orbit.size();
+        index /= levels[i].orbit.size();
+    }
+    // Sift the product, following only where each base point goes
+    unsigned long long product = 0;
+    std::vector<int> productIndices(levels.size());
+    for (size_t i = 0; i < levels.size(); i++) {
+        int point = perm[levels[i].point];
+        for (size_t j = levels.size(); j-- > 0;) {
+            point = levels[j].transversal[indices[j]][point];
+        }
+        for (size_t j = 0; j < i; j++) {
+            point = levels[j].inverses[productIndices[j]][point];
+        }
+        productIndices[i] = levels[i].orbitIndex[point];
+        product = product * levels[i].orbit.size() + productIndices[i];
+    }
+    return product;
+}
+
+static void rotate4in8(std::array<int, 8>& cells, std::array<int, 4> indices) {
+    int temp = cells[indices[0]];
+    for (int i = 0; i < 3; i++) {
+        cells[indices[i]] = cells[indices[i + 1]];
+    }
+    cells[indices[3]] = temp;
+}
+
+static void rotate8bycell(std::array<int, 8>& cells, CellLocation cell) {
+    if (cell == RIGHT) {
+        rotate4in8(cells, {0, 6, 1, 7});
+    } else if (cell == LEFT) {
+        rotate4in8(cells, {1, 6, 0, 7});
+    } else if (cell == UP) {
+        rotate4in8(cells, {2, 6, 3, 7});
+    } else if (cell == DOWN) {
+        rotate4in8(cells, {3, 6, 2, 7});
+    } else if (cell == FRONT) {
+        rotate4in8(cells, {4, 6, 5, 7});
+    } else if (cell == BACK) {
+        rotate4in8(cells, {5, 6, 4, 7});
+    }
+}
+
+void Scrambler::reorientScramble(std::vector<MoveEntry>& scramble) {
+    MoveEntry entry;
+    // R, L, U, D, F, B, O, I
+    // Reorient to HSC default orientation
+    std::array<int, 8> cells = {0, 1, 4, 5, 3, 2, 6, 7};
+    for (size_t i = 0; i < scramble.size(); i++) {
+        if (scramble[i].type == GYRO) {
+            rotate8bycell(cells, scramble[i].cell);
+        }
+    }
+    entry.type = GYRO;
+    std::array<int, 3> colorsToFix = {4, 2, 7};
+    for (int i = 0; i < 3; i++) {
+        int index = std::distance(cells.begin(), std::find(cells.begin(), cells.end(), colorsToFix[i]));
+        if (index != colorsToFix[i]) {
+            // Move to I
+            if (index == 6) {
+                entry.cell = LEFT;
+                scramble.push_back(entry);
+                scramble.push_back(entry);
+                rotate8bycell(cells, entry.cell);
+                rotate8bycell(cells, entry.cell);
+            } else if (index < 6) {
+                entry.cell = (CellLocation)(2 + index);
+                scramble.push_back(entry);
+                rotate8bycell(cells, entry.cell);
+            }
+            // Move to desired location (gyro opposite)
+            if (colorsToFix[i] != 7) {
+                // Don't gyro if inner
+                entry.cell = (CellLocation)(2 + colorsToFix[i] + 1);
+                scramble.push_back(entry);
+                rotate8bycell(cells, entry.cell);
+            }
+        }
+    }
+}
+
+// Scrambles are formatted in bulk, so skip the stream machinery
+static void appendNumber(std::string& text, int value, char separator) {
+    if (value < 0) {
+        text += '-';
+        value = -value;
+    }
+    if (value >= 10) text += (char)('0' + value / 10);
+    text += (char)('0' + value % 10);
+    text += separator;
+}
+
+std::string Scrambler::getHscScramble(const std::vector<MoveEntry>& scramble) {
+    std::vector<HscTwist> twists(1, HscTranslator::orientation);
+    std::vector<HscTwist> moves = HscTranslator::toTwists(scramble);
+    twists.insert(twists.end(), moves.begin(), moves.end());
+    std::string hscScramble;
+    HscTranslator::appendTwists(hscScramble, twists);
+    hscScramble += ' ';
+    return hscScramble;
+}
+
+std::string Scrambler::getPhysScramble(const std::vector<MoveEntry>& scramble) {
+    std::string physScramble;
+    physScramble.reserve(scramble.size() * 5);
+    for (size_t i = 0; i < scramble.size(); i++) {
+        if (scramble[i].type == GYRO) {
+            appendNumber(physScramble, (int)scramble[i].cell, ',');
+            appendNumber(physScramble, -1, ' ');
+        } else {
+            appendNumber(physScramble, (int)scramble[i].cell, ',');
+            appendNumber(physScramble, (int)scramble[i].direction, ' ');
+        }
+    }
+    return physScramble;
+}
+
+static bool isSpace(unsigned char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v';
+}
+
+// Reads an integer at offset, held at INT_MAX / 10 so that long ones are
+// still read whole and then found out of range
+static bool parseInteger(const unsigned char *data, size_t end, size_t& offset, int& value) {
+    bool negative = offset < end && data[offset] == '-';
+    if (negative) offset++;
+    if (offset >= end || data[offset] < '0' || data[offset] > '9') return false;
+    value = 0;
+    while (offset < end && data[offset] >= '0' && data[offset] <= '9') {
+        int digit = data[offset++] - '0';
+        value = (value >= INT_MAX / 10) ? INT_MAX / 10 : value * 10 + digit;
+    }
+    if (negative) value = -value;
+    return true;
+}
+
+// Reads the word from begin to end as cell,direction, false if it is not
+// two integers joined by a comma
+static bool parseMove(const unsigned char *data, size_t begin, size_t end, int& cell, int& direction) {
+    size_t offset = begin;
+    if (!parseInteger(data, end, offset, cell)) return false;
+    if (offset >= end || data[offset++] != ',') return false;
+    if (!parseInteger(data, end, offset, direction)) return false;
+    return offset == end;
+}
+
+ScrambleCorpus::ScrambleCorpus() {
+    close();
+}
+
+bool ScrambleCorpus::open(const std::string& filename) {
+    close();
+    return file.open(filename);
+}
+
+void ScrambleCorpus::close() {
+    file.close();
+    begins.clear();
+    ends.clear();
+    scanned = 0;
+    inScramble = false;
+    lastMove = 0;
+}
+
+void ScrambleCorpus::indexTo(size_t index) {
+    const unsigned char *data = file.getData();
+    size_t size = file.getSize();
+    int cell, direction;
+    while (ends.size() <= index && scanned < size) {
+        if (isSpace(data[scanned])) {
+            scanned++;
+            continue;
+        }
+        size_t end = scanned;
+        while (end < size && !isSpace(data[end])) end++;
+        if (parseMove(data, scanned, end, cell, direction)) {
+            if (!inScramble) begins.push_back(scanned);
+            inScramble = true;
+            lastMove = end;
+        } else if (inScramble) {
+            ends.push_back(lastMove);
+            inScramble = false;
+        }
+        scanned = end;
+    }
+    if (scanned >= size && inScramble) {
+        ends.push_back(lastMove);
+        inScramble = false;
+    }
+}
+
+bool ScrambleCorpus::hasScramble(size_t index) {
+    indexTo(index);
+    return index < ends.size();
+}
+
+size_t ScrambleCorpus::getNumScrambles() const {
+    return ends.size();
+}
+
+bool ScrambleCorpus::isIndexed() const {
+    return scanned >= file.getSize() && !inScramble;
+}
+
+bool ScrambleCorpus::getScramble(size_t index, std::vector<MoveEntry>& scramble, size_t& errorOffset) const {
+    scramble.clear();
+    const unsigned char *data = file.getData();
+    PuzzleState solved;
+    MoveEntry entry;
+    int cell, direction;
+    // Only moves and whitespace were indexed
+    for (size_t begin = begins[index]; begin < ends[index];) {
+        if (isSpace(data[begin])) {
+            begin++;
+            continue;
+        }
+        size_t end = begin;
+        while (end < ends[index] && !isSpace(data[end])) end++;
+        parseMove(data, begin, end, cell, direction);
+        MoveCode move = NUM_MOVES;
+        if (cell >= 0 && cell < 8 && direction >= -1 && direction < 6) {
+            entry.type = (direction == -1) ? GYRO : TURN;
+            entry.cell = (CellLocation)cell;
+            entry.direction = (RotateDirection)direction;
+            move = PuzzleState::getMoveCode(entry);
+        }
+        if (move == NUM_MOVES) {
+            errorOffset = begin;
+            return false;
+        }
+        scramble.push_back(solved.getMoveEntry(move));
+        begin = end;
+    }
+    return true;
+}
@@ -0,0 +1,225 @@
+/**************************************************************************
+ * 3to4++ - https://github.com/rayzchen/3to4++
+ *-------------------------------------------------------------------------
+ * Copyright 2024 Ray Chen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ **************************************************************************/
+
+#ifndef SCRAMBLER_H
+#define SCRAMBLER_H
+
+#include <array>
+#include <vector>
+#include <string>
+#include <random>
+#include "mapping.h"
+#include "state.h"
+
+typedef std::array<unsigned char, NUM_STICKERS> StickerPermutation;
+
+// Counter based generator: output k of stream (seed, index) depends on
+// nothing else, so scrambles come out the same however work is split up
+class SplitMix64 {
+    public:
+        typedef unsigned long long result_type;
+        SplitMix64(unsigned long long seed, unsigned long long stream);
+        result_type operator()();
+        static constexpr result_type min() { return 0; }
+        static constexpr result_type max() { return ~0ULL; }
+
+    private:
+        unsigned long long key;
+        unsigned long long counter;
+};
+
+// Stabilizer chain of the group generated by the sticker moves, built with
+// the random Schreier-Sims algorithm. Sifting through the chain decides
+// whether a state can be reached at all, and picking one coset
+// representative per level gives uniformly random reachable states.
+class Scrambler {
+    public:
+        Scrambler();
+        // Chain for the subgroup generated by some other permutations
+        Scrambler(const std::vector<StickerPermutation>& generators);
+        template <typename Rng> PuzzleState randomState(Rng& rng) const;
+        bool isReachable(const PuzzleState& state) const;
+        // Number of reachable sticker arrangements, in decimal
+        std::string getGroupOrder() const;
+        // False if the order does not fit in 64 bits
+        bool getGroupOrder(unsigned long long& order) const;
+        // Group elements are numbered 0 to order - 1 by their coset
+        // representatives, with 0 the identity. Gives the number of the
+        // element followed by perm, which has to be in the group, looking
+        // only at the base points instead of building either permutation.
+        unsigned long long getProductIndex(unsigned long long index, const StickerPermutation& perm) const;
+
+        // Permutations of the sticker moves that move any sticker
+        static std::vector<StickerPermutation> getMoveGenerators();
+
+        // Random move scrambles, 45 moves when scrambleLength is 0. Weights
+        // pick gyro or turn, then which cell to turn (IN to BACK)
+        template <typename Rng> static std::vector<MoveEntry> randomMoves(int scrambleLength, Rng& rng);
+        template <typename Rng> static std::vector<MoveEntry> randomMoves(int scrambleLength, Rng& rng,
+                                                                          const std::vector<double>& typeWeights,
+                                                                          const std::vector<double>& cellWeights);
+        static void reorientScramble(std::vector<MoveEntry>& scramble);
+        static std::string getHscScramble(const std::vector<MoveEntry>& scramble);
+        static std::string getPhysScramble(const std::vector<MoveEntry>& scramble);
+
+    private:
+        struct Level {
+            int point;
+            std::vector<StickerPermutation> generators;
+            std::vector<int> orbit;
+            // Index into orbit of each sticker position, -1 if absent
+            std::array<short, NUM_STICKERS> orbitIndex;
+            // Maps point to orbit[i], and its inverse
+            std::vector<StickerPermutation> transversal;
+            std::vector<StickerPermutation> inverses;
+        };
+        std::vector<Level> levels;
+
+        size_t sift(StickerPermutation& perm) const;
+        void addGenerator(StickerPermutation perm);
+        void buildOrbit(Level& level);
+};
+
+// Scrambles in the cell,direction format of scramble.txt, gyros having
+// direction -1. Moves are two integers joined by a comma, and any amount of
+// whitespace, blank lines included, may come between them. Any other word,
+// like the three number twists of the HSC scramble lines, ends a scramble,
+// so the phys_scramble lines written by 3to4++-scramble are read as one
+// scramble each. The file is mapped on opening and indexed only as far as
+// the scrambles asked for, so opening is instant and a scramble is found by
+// reading the file up to its end once.
+class ScrambleCorpus {
+    public:
+        ScrambleCorpus();
+        bool open(const std::string& filename);
+        void close();
+        // Indexes the file up to the scramble
+        bool hasScramble(size_t index);
+        // Scrambles indexed so far, all of them once isIndexed
+        size_t getNumScrambles() const;
+        bool isIndexed() const;
+        // Cell turns and gyros as picked, without slice gyros, for a
+        // scramble hasScramble found. False with the byte offset of the
+        // first move that is not one of the puzzle.
+        bool getScramble(size_t index, std::vector<MoveEntry>& scramble, size_t& errorOffset) const;
+
+    private:
+        MappedFile file;
+        // Byte range of each scramble
+        std::vector<size_t> begins;
+        std::vector<size_t> ends;
+        // Where indexing stopped, inside a scramble or not
+        size_t scanned;
+        bool inScramble;
+        size_t lastMove;
+
+        void indexTo(size_t index);
+};
+
+template <typename Rng>
+PuzzleState Scrambler::randomState(Rng& rng) const {
+    StickerPermutation perm;
+    for (int i = 0; i < NUM_STICKERS; i++) {
+        perm[i] = i;
+    }
+    for (size_t i = 0; i < levels.size(); i++) {
+        std::uniform_int_distribution<size_t> dist(0, levels[i].transversal.size() - 1);
+        const StickerPermutation& representative = levels[i].transversal[dist(rng)];
+        StickerPermutation result;
+        for (int j = 0; j < NUM_STICKERS; j++) {
+            result[j] = perm[representative[j]];
+        }
+        perm = result;
+    }
+    PuzzleState state;
+    state.stickers = perm;
+    return state;
+}
+
+template <typename Rng>
+std::vector<MoveEntry> Scrambler::randomMoves(int scrambleLength, Rng& rng) {
+    static const std::vector<double> typeWeights = {2, 3};
+    // FBUD only for visual effect, functionally unneeded
+    static const std::vector<double> cellWeights = {2, 2, 6, 6, 1, 1, 1, 1};
+    return randomMoves(scrambleLength, rng, typeWeights, cellWeights);
+}
+
+template <typename Rng>
+std::vector<MoveEntry> Scrambler::randomMoves(int scrambleLength, Rng& rng,
+                                              const std::vector<double>& typeWeights,
+                                              const std::vector<double>& cellWeights) {
+    std::discrete_distribution<int> typeDist(typeWeights.begin(), typeWeights.end());
+    std::uniform_int_distribution<int> directionDist(0, 5);
+    std::discrete_distribution<int> cellDist(cellWeights.begin(), cellWeights.end());
+    std::uniform_int_distribution<int> boolDist(0, 1);
+    std::vector<MoveEntry> scramble;
+    MoveEntry entry;
+    entry.type = TURN;
+    if (scrambleLength == 0) {
+        scrambleLength = 45;
+    }
+    CellLocation lastCell = (CellLocation)-1;
+    for (int i = 0; i < scrambleLength; i++) {
+        if (typeDist(rng) == 0 && entry.type != GYRO) {
+            // don't include gyros in scramble length
+            i--;
+            entry.type = GYRO;
+            entry.cell = (CellLocation)(2 + directionDist(rng));
+        } else {
+            entry.type = TURN;
+            while (true) {
+                entry.cell = (CellLocation)cellDist(rng);
+                if (entry.cell != lastCell) break;
+                if (entry.cell == LEFT || entry.cell == RIGHT) break;
+            }
+            lastCell = entry.cell;
+            switch (entry.cell) {
+                case IN:
+                case OUT:
+                    // YZ or ZY
+                    entry.direction = (RotateDirection)boolDist(rng);
+                    break;
+                case UP:
+                case DOWN:
+                    // XZ or ZX
+                    entry.direction = (RotateDirection)(2 + boolDist(rng));
+                    break;
+                case FRONT:
+                case BACK:
+                    // XY or YX
+                    entry.direction = (RotateDirection)(4 + boolDist(rng));
+                    break;
+                case LEFT:
+                case RIGHT:
+                    // any
+                    entry.direction = (RotateDirection)directionDist(rng);
+                    break;
+            }
+        }
+        scramble.push_back(entry);
+    }
+
+    bool reorient = false;
+    if (reorient) {
+        reorientScramble(scramble);
+    }
+    return scramble;
+}
+
+#endif // scrambler.h
@@ -0,0 +1,518 @@
+/**************************************************************************
+ * 3to4++ - https://github.com/rayzchen/3to4++
+ *-------------------------------------------------------------------------
+ * Copyright 2024 Ray Chen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ **************************************************************************/
+
+#include "session.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#define SESSION_MAGIC "3to4ses"
+#define JOURNAL_MAGIC "3to4jnl"
+#define JOURNAL_CHECKSUM_SEED 2166136261u
+#define SESSION_VERSION 1
+#define SESSION_STATE_BYTES (NUM_STICKERS + 1)
+// Records are written out once this many bytes are waiting
+#define SESSION_FLUSH_BYTES 256
+
+struct SessionHeader {
+    char magic[8];
+    unsigned int version;
+    unsigned int coreVersion;
+};
+
+struct SessionTables {
+    std::array<MoveEntry, NUM_SESSION_MOVES> entries;
+
+    SessionTables();
+};
+
+static const SessionTables& getTables() {
+    static SessionTables tables;
+    return tables;
+}
+
+SessionTables::SessionTables() {
+    PuzzleState state;
+    for (int code = 0; code < NUM_SESSION_MOVES; code++) {
+        entries[code] = state.getMoveEntry(SessionReader::getMoveCode(code));
+        if (entries[code].type == GYRO_OUTER) entries[code].location = (code == SESSION_GYRO_OUTER_PLUS) ? 1 : -1;
+    }
+}
+
+// Unsigned LEB128, false if it runs past the end
+static bool readVarint(const unsigned char *data, size_t size, size_t& offset, unsigned long long& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && offset < size; shift += 7) {
+        unsigned char byte = data[offset++];
+        value |= (unsigned long long)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+static void writeVarint(std::vector<unsigned char>& buffer, unsigned long long value) {
+    while (value >= 0x80) {
+        buffer.push_back((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    buffer.push_back(value);
+}
+
+// False if any byte is out of range
+static bool readState(const unsigned char *data, PuzzleState& state) {
+    for (int i = 0; i < NUM_STICKERS; i++) {
+        if (data[i] >= NUM_STICKERS) return false;
+        state.stickers[i] = data[i];
+    }
+    if (data[NUM_STICKERS] >= NUM_CONFIGS) return false;
+    state.config = data[NUM_STICKERS];
+    return true;
+}
+
+// FNV-1a, carried on from the checksum of the record before
+static unsigned int getChecksum(unsigned int checksum, const unsigned char *data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        checksum = (checksum ^ data[i]) * 16777619u;
+    }
+    return checksum;
+}
+
+SessionWriter::SessionWriter() {
+    file = NULL;
+    lastTime = 0;
+    moves = 0;
+}
+
+SessionWriter::~SessionWriter() {
+    close();
+}
+
+bool SessionWriter::open(const std::string& filename) {
+    close();
+    long size = 0;
+    FILE *existing = fopen(filename.c_str(), "rb");
+    if (existing != NULL) {
+        if (fseek(existing, 0, SEEK_END) == 0) size = ftell(existing);
+        fclose(existing);
+    }
+    if (size != 0) {
+        // Records appended after a damaged one could never be read back
+        SessionReader reader;
+        if (!reader.open(filename) || reader.getValidSize() != (size_t)size) return false;
+    }
+    file = fopen(filename.c_str(), "ab");
+    if (file == NULL) return false;
+    lastTime = 0;
+    moves = 0;
+    state = PuzzleState();
+    if (size == 0) {
+        SessionHeader header;
+        memset(&header, 0, sizeof(header));
+        strcpy(header.magic, SESSION_MAGIC);
+        header.version = SESSION_VERSION;
+        header.coreVersion = PUZZLE_CORE_VERSION;
+        const unsigned char *bytes = (const unsigned char*)&header;
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(header));
+    }
+    return flush();
+}
+
+void SessionWriter::close() {
+    if (file == NULL) return;
+    flush();
+    fclose(file);
+    file = NULL;
+}
+
+bool SessionWriter::isOpen() const {
+    return file != NULL;
+}
+
+bool SessionWriter::writeStart(const PuzzleState& start, unsigned long long time) {
+    if (file == NULL) return false;
+    buffer.push_back(SESSION_START);
+    writeVarint(time >= lastTime ? time - lastTime : 0);
+    lastTime = std::max(lastTime, time);
+    state = start;
+    moves = 0;
+    writeState();
+    return flush();
+}
+
+bool SessionWriter::writeMove(const MoveEntry& entry, unsigned long long time) {
+    unsigned char code = SessionReader::getSessionCode(entry);
+    if (file == NULL || code == NUM_SESSION_MOVES) return false;
+    buffer.push_back(code);
+    writeVarint(time >= lastTime ? time - lastTime : 0);
+    lastTime = std::max(lastTime, time);
+    state.applyMove(SessionReader::getMoveCode(code));
+    moves++;
+    if (moves % SESSION_CHECKPOINT_INTERVAL == 0) {
+        buffer.push_back(SESSION_CHECKPOINT);
+        writeVarint(moves);
+        writeState();
+    }
+    if (buffer.size() < SESSION_FLUSH_BYTES) return true;
+    return flush();
+}
+
+bool SessionWriter::flush() {
+    if (file == NULL) return false;
+    bool written = buffer.empty() || fwrite(buffer.data(), buffer.size(), 1, file) == 1;
+    buffer.clear();
+    return fflush(file) == 0 && written;
+}
+
+void SessionWriter::writeVarint(unsigned long long value) {
+    ::writeVarint(buffer, value);
+}
+
+void SessionWriter::writeState() {
+    buffer.insert(buffer.end(), state.stickers.begin(), state.stickers.end());
+    buffer.push_back(state.config);
+}
+
+SessionReader::SessionReader() {
+    validSize = 0;
+}
+
+SessionReader::~SessionReader() {
+    close();
+}
+
+bool SessionReader::open(const std::string& filename) {
+    close();
+    if (!mapping.open(filename) || !index()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void SessionReader::close() {
+    mapping.close();
+    validSize = 0;
+    codes.clear();
+    times.clear();
+    checkpointMoves.clear();
+    checkpointStates.clear();
+}
+
+bool SessionReader::hasSession() const {
+    return !checkpointStates.empty();
+}
+
+size_t SessionReader::getValidSize() const {
+    return validSize;
+}
+
+size_t SessionReader::getNumMoves() const {
+    return codes.size();
+}
+
+MoveEntry SessionReader::getMove(size_t index) const {
+    return getSessionEntry(codes[index]);
+}
+
+unsigned long long SessionReader::getTime(size_t index) const {
+    return times[index];
+}
+
+PuzzleState SessionReader::getState(size_t count) const {
+    PuzzleState state;
+    if (checkpointMoves.empty()) return state;
+    // Last checkpoint at or before count
+    size_t i = std::upper_bound(checkpointMoves.begin(), checkpointMoves.end(), count) -
+               checkpointMoves.begin() - 1;
+    readState(checkpointStates[i], state);
+    for (size_t move = checkpointMoves[i]; move < count && move < codes.size(); move++) {
+        state.applyMove(getMoveCode(codes[move]));
+    }
+    return state;
+}
+
+bool SessionReader::isSessionFile(const std::string& filename) {
+    FILE *file = fopen(filename.c_str(), "rb");
+    if (file == NULL) return false;
+    char magic[sizeof(SESSION_MAGIC)];
+    bool found = fread(magic, sizeof(magic), 1, file) == 1 && memcmp(magic, SESSION_MAGIC, sizeof(magic)) == 0;
+    fclose(file);
+    return found;
+}
+
+MoveEntry SessionReader::getSessionEntry(unsigned char code) {
+    return getTables().entries[code];
+}
+
+unsigned char SessionReader::getSessionCode(const MoveEntry& entry) {
+    MoveCode move = PuzzleState::getMoveCode(entry);
+    if (move == NUM_MOVES) return NUM_SESSION_MOVES;
+    if (entry.type == GYRO_OUTER && entry.location == 1) return SESSION_GYRO_OUTER_PLUS;
+    return move;
+}
+
+MoveCode SessionReader::getMoveCode(unsigned char code) {
+    return (code == SESSION_GYRO_OUTER_PLUS) ? (MoveCode)MOVE_GYRO_OUTER : code;
+}
+
+bool SessionReader::index() {
+    const unsigned char *data = mapping.getData();
+    size_t mappingSize = mapping.getSize();
+    SessionHeader header;
+    if (mappingSize < sizeof(header)) return false;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, SESSION_MAGIC, sizeof(SESSION_MAGIC)) != 0 || header.version != SESSION_VERSION ||
+        header.coreVersion != PUZZLE_CORE_VERSION) {
+        return false;
+    }
+
+    // Only the last session is kept, so earlier ones are skimmed over
+    size_t offset = sizeof(header);
+    validSize = offset;
+    unsigned long long time = 0;
+    PuzzleState state;
+    while (offset < mappingSize) {
+        unsigned char type = data[offset];
+        size_t next = offset + 1;
+        unsigned long long value;
+        if (type < NUM_SESSION_MOVES) {
+            if (!readVarint(data, mappingSize, next, value)) break;
+            time += value;
+            if (!checkpointStates.empty()) {
+                codes.push_back(type);
+                times.push_back(time);
+            }
+        } else if (type == SESSION_START || type == SESSION_CHECKPOINT) {
+            if (!readVarint(data, mappingSize, next, value)) break;
+            if (next + SESSION_STATE_BYTES > mappingSize || !readState(data + next, state)) break;
+            if (type == SESSION_START) {
+                codes.clear();
+                times.clear();
+                checkpointMoves.clear();
+                checkpointStates.clear();
+                time = 0;
+                checkpointMoves.push_back(0);
+                checkpointStates.push_back(data + next);
+            } else if (!checkpointStates.empty() && value == codes.size()) {
+                checkpointMoves.push_back(value);
+                checkpointStates.push_back(data + next);
+            }
+            next += SESSION_STATE_BYTES;
+        } else {
+            break;
+        }
+        offset = next;
+        validSize = offset;
+    }
+    return true;
+}
+
+Journal::Journal() {
+    file = NULL;
+    stopping = false;
+    checksum = JOURNAL_CHECKSUM_SEED;
+    lastTime = 0;
+}
+
+Journal::~Journal() {
+    close();
+}
+
+static bool syncFile(FILE *file) {
+    if (fflush(file) != 0) return false;
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+bool Journal::open(const std::string& filename) {
+    close();
+    this->filename = filename;
+    partial = filename + ".part";
+    file = fopen(partial.c_str(), "wb");
+    if (file == NULL) return false;
+    SessionHeader header;
+    memset(&header, 0, sizeof(header));
+    strcpy(header.magic, JOURNAL_MAGIC);
+    header.version = SESSION_VERSION;
+    header.coreVersion = PUZZLE_CORE_VERSION;
+    const unsigned char *bytes = (const unsigned char*)&header;
+    queue.assign(bytes, bytes + sizeof(header));
+    checksum = JOURNAL_CHECKSUM_SEED;
+    lastTime = 0;
+    stopping = false;
+    return true;
+}
+
+bool Journal::commit() {
+    if (file == NULL || writer.joinable()) return file != NULL;
+    // Nothing else touches the queue until the writer starts
+    bool written = queue.empty() || fwrite(queue.data(), queue.size(), 1, file) == 1;
+    written = syncFile(file) && written;
+    written = fclose(file) == 0 && written;
+    queue.clear();
+    file = NULL;
+    if (written) {
+#ifdef _WIN32
+        remove(filename.c_str());
+#endif
+        written = rename(partial.c_str(), filename.c_str()) == 0;
+    }
+    if (!written) {
+        remove(partial.c_str());
+        return false;
+    }
+    file = fopen(filename.c_str(), "ab");
+    if (file == NULL) return false;
+    writer = std::thread(&Journal::run, this);
+    return true;
+}
+
+void Journal::close() {
+    if (file == NULL) return;
+    if (!writer.joinable()) {
+        commit();
+        if (file == NULL) return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    writer.join();
+    fclose(file);
+    file = NULL;
+}
+
+bool Journal::isOpen() const {
+    return file != NULL;
+}
+
+void Journal::writeStart(const PuzzleState& state, unsigned long long time) {
+    if (file == NULL) return;
+    record.push_back(SESSION_START);
+    ::writeVarint(record, time >= lastTime ? time - lastTime : 0);
+    lastTime = std::max(lastTime, time);
+    record.insert(record.end(), state.stickers.begin(), state.stickers.end());
+    record.push_back(state.config);
+    queueRecord();
+}
+
+void Journal::writeMove(const MoveEntry& entry, unsigned long long time) {
+    unsigned char code = SessionReader::getSessionCode(entry);
+    if (file == NULL || code == NUM_SESSION_MOVES) return;
+    record.push_back(code);
+    ::writeVarint(record, time >= lastTime ? time - lastTime : 0);
+    lastTime = std::max(lastTime, time);
+    queueRecord();
+}
+
+void Journal::writeSeek(size_t position) {
+    if (file == NULL) return;
+    record.push_back(SESSION_SEEK);
+    ::writeVarint(record, position);
+    queueRecord();
+}
+
+bool Journal::read(const std::string& filename, PuzzleState& start, std::vector<JournalRecord>& records) {
+    records.clear();
+    MappedFile mapping;
+    if (!mapping.open(filename)) return false;
+    const unsigned char *data = mapping.getData();
+    size_t size = mapping.getSize();
+    SessionHeader header;
+    bool started = false;
+    if (size >= sizeof(header)) {
+        memcpy(&header, data, sizeof(header));
+    }
+    if (size >= sizeof(header) && memcmp(header.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) == 0 &&
+        header.version == SESSION_VERSION && header.coreVersion == PUZZLE_CORE_VERSION) {
+        size_t offset = sizeof(header);
+        unsigned int expected = JOURNAL_CHECKSUM_SEED;
+        unsigned long long time = 0;
+        while (offset < size) {
+            unsigned char type = data[offset];
+            size_t next = offset + 1;
+            unsigned long long value;
+            if (!readVarint(data, size, next, value)) break;
+            if (type == SESSION_START) {
+                if (next + SESSION_STATE_BYTES > size) break;
+                next += SESSION_STATE_BYTES;
+            } else if (type != SESSION_SEEK && type >= NUM_SESSION_MOVES) {
+                break;
+            }
+            if (next + 4 > size) break;
+            expected = getChecksum(expected, data + offset, next - offset);
+            unsigned int stored = data[next] | data[next + 1] << 8 | data[next + 2] << 16 |
+                                  (unsigned int)data[next + 3] << 24;
+            if (stored != expected) break;
+
+            if (type == SESSION_START) {
+                PuzzleState state;
+                if (!readState(data + next - SESSION_STATE_BYTES, state)) break;
+                start = state;
+                started = true;
+                records.clear();
+                time = 0;
+            } else if (started) {
+                if (type != SESSION_SEEK) value = time += value;
+                records.push_back({type, value});
+            }
+            offset = next + 4;
+        }
+    }
+    return started;
+}
+
+void Journal::queueRecord() {
+    checksum = getChecksum(checksum, record.data(), record.size());
+    for (int i = 0; i < 4; i++) {
+        record.push_back(checksum >> (8 * i));
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.insert(queue.end(), record.begin(), record.end());
+    }
+    record.clear();
+}
+
+void Journal::run() {
+    std::vector<unsigned char> batch;
+    bool done = false;
+    while (!done) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait_for(lock, std::chrono::milliseconds(JOURNAL_SYNC_INTERVAL), [this] { return stopping; });
+            batch.swap(queue);
+            done = stopping;
+        }
+        if (batch.empty()) continue;
+        fwrite(batch.data(), batch.size(), 1, file);
+        syncFile(file);
+        batch.clear();
+    }
+}
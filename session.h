@@ -0,0 +1,186 @@
+/**************************************************************************
+ * 3to4++ - https://github.com/rayzchen/3to4++
+ *-------------------------------------------------------------------------
+ * Copyright 2024 Ray Chen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ **************************************************************************/
+
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "mapping.h"
+#include "state.h"
+
+// Session files are a header and then records, and are only ever appended
+// to. Every record starts with a byte:
+//   move        a session move code, then the milliseconds since the last
+//               record as a varint
+//   start       SESSION_START, the milliseconds since the last record, then
+//               the state the moves after it are played from
+//   checkpoint  SESSION_CHECKPOINT, the number of moves since the start as
+//               a varint, then the state after them
+// States are the stickers and the config, one byte each. A record cut
+// short at the end of the file is ignored.
+#define SESSION_START 0x80
+#define SESSION_CHECKPOINT 0x81
+// Moves between checkpoints
+#define SESSION_CHECKPOINT_INTERVAL 1024
+
+// Session move codes are move codes, except that outer slice gyros get one
+// code per location, so entries come back exactly without the slice config
+typedef enum : int {
+    SESSION_GYRO_OUTER_PLUS = NUM_MOVES, // MOVE_GYRO_OUTER is location -1
+    NUM_SESSION_MOVES
+} SessionMoveCodeLayout;
+
+// Appends the moves of a session to a file as they are played
+class SessionWriter {
+    public:
+        SessionWriter();
+        ~SessionWriter();
+        SessionWriter(const SessionWriter&) = delete;
+        SessionWriter& operator=(const SessionWriter&) = delete;
+        // Creates the file or carries on an existing session file. False
+        // if it cannot be written or holds anything else.
+        bool open(const std::string& filename);
+        void close();
+        bool isOpen() const;
+        // Times are in milliseconds from any fixed point
+        bool writeStart(const PuzzleState& state, unsigned long long time);
+        // False for entries with no code
+        bool writeMove(const MoveEntry& entry, unsigned long long time);
+        bool flush();
+
+    private:
+        FILE *file;
+        unsigned long long lastTime;
+        // State after the moves so far, for the checkpoints
+        PuzzleState state;
+        size_t moves;
+        std::vector<unsigned char> buffer;
+
+        void writeVarint(unsigned long long value);
+        void writeState();
+};
+
+// Maps a session file read-only and indexes its last session. Nothing is
+// replayed on opening, states come from the nearest checkpoint.
+class SessionReader {
+    public:
+        SessionReader();
+        ~SessionReader();
+        SessionReader(const SessionReader&) = delete;
+        SessionReader& operator=(const SessionReader&) = delete;
+        // False if the file is missing, not a session file or from another
+        // puzzle core version
+        bool open(const std::string& filename);
+        void close();
+        // Whether a session was started in the file at all
+        bool hasSession() const;
+        // Bytes up to the end of the last whole record
+        size_t getValidSize() const;
+        size_t getNumMoves() const;
+        MoveEntry getMove(size_t index) const;
+        // Milliseconds from the start of the session
+        unsigned long long getTime(size_t index) const;
+        // State after the first count moves
+        PuzzleState getState(size_t count) const;
+
+        static bool isSessionFile(const std::string& filename);
+        static MoveEntry getSessionEntry(unsigned char code);
+        // NUM_SESSION_MOVES for entries with no code
+        static unsigned char getSessionCode(const MoveEntry& entry);
+        static MoveCode getMoveCode(unsigned char code);
+
+    private:
+        MappedFile mapping;
+        size_t validSize;
+        std::vector<unsigned char> codes;
+        std::vector<unsigned long long> times;
+        // Moves played before each checkpoint, and its state in the file
+        std::vector<size_t> checkpointMoves;
+        std::vector<const unsigned char*> checkpointStates;
+
+        bool index();
+};
+
+// Journals are session files of a history, with one more record:
+//   seek        SESSION_SEEK, then the position in the history as a varint
+// and a 32 bit checksum after every record, chained from the one before, so
+// that a record torn or garbled by a crash ends the journal.
+#define SESSION_SEEK 0x82
+// Milliseconds between writes of the journal to disk
+#define JOURNAL_SYNC_INTERVAL 500
+
+struct JournalRecord {
+    // A session move code or SESSION_SEEK
+    unsigned char type;
+    // Milliseconds from the start for moves, the position for seeks
+    unsigned long long value;
+};
+
+// Appends to a journal from a background thread. Records are only queued
+// by the caller, and written and synced every JOURNAL_SYNC_INTERVAL. A new
+// journal is written under another name until it is committed, so the old
+// one is kept until the new one holds everything it needs.
+class Journal {
+    public:
+        Journal();
+        ~Journal();
+        Journal(const Journal&) = delete;
+        Journal& operator=(const Journal&) = delete;
+        // Starts a new journal, which replaces the file once committed
+        bool open(const std::string& filename);
+        // Writes and syncs everything queued, puts the journal in place of
+        // the old file and starts writing in the background. False if the
+        // old file was kept, after which nothing more is written.
+        bool commit();
+        // Writes everything queued before returning
+        void close();
+        bool isOpen() const;
+        void writeStart(const PuzzleState& state, unsigned long long time);
+        void writeMove(const MoveEntry& entry, unsigned long long time);
+        void writeSeek(size_t position);
+
+        // Reads the last history of a journal, up to the first record that
+        // fails its checksum. False if no history was started in it.
+        static bool read(const std::string& filename, PuzzleState& start, std::vector<JournalRecord>& records);
+
+    private:
+        FILE *file;
+        std::string filename;
+        // Name the journal is written under until it is committed
+        std::string partial;
+        std::thread writer;
+        std::mutex mutex;
+        std::condition_variable wake;
+        bool stopping;
+        // Records waiting for the writer, and the one being encoded
+        std::vector<unsigned char> queue;
+        std::vector<unsigned char> record;
+        unsigned int checksum;
+        unsigned long long lastTime;
+
+        void queueRecord();
+        void run();
+};
+
+#endif // session.h
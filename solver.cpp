@@ -0,0 +1,1456 @@
+/**************************************************************************
+ * 3to4++ - https://github.com/rayzchen/3to4++
+ *-------------------------------------------------------------------------
+ * Copyright 2024 Ray Chen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ **************************************************************************/
+
+#include "solver.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+#include <set>
+#include <thread>
+#include <unordered_set>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+// Prevent name collision with enum
+#undef IN
+#undef OUT
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define FOUND -1
+#define UNREACHED 255
+// Largest distance a table holds, two to a byte
+#define MAX_PACKED_DISTANCE 15
+// Saved tables start their data on a page boundary after the header
+#define DATABASE_MAGIC "3to4PDB"
+#define DATABASE_VERSION 1
+#define DATABASE_DATA_OFFSET 4096
+#define MAX_DATABASE_PIECES 8
+// Nodes the staged solver spends looking for a short solution first
+#define STAGED_SEARCH_NODES 100000
+// Search threads add their nodes to the shared count this often
+#define NODE_BATCH 4096
+// The tree is split until every thread has about this many tasks
+#define TASKS_PER_THREAD 32
+// Transposition table entries, and the fields packed in each
+#define TRANSPOSITION_BITS 20
+#define TRANSPOSITION_KEY_SHIFT 24
+#define TRANSPOSITION_FIELD_BITS 8
+#define TRANSPOSITION_FIELD_MASK 0xffULL
+// States with less cost left than this are cheaper to search again
+#define TRANSPOSITION_MIN_REMAINING 2
+// States a beam search keeps at each depth, and the bytes it may use
+#define BEAM_WIDTH 256
+#define BEAM_MEMORY ((size_t)256 << 20)
+// Beam searches stop after this many depths without getting closer
+#define BEAM_STALL 6
+#define BEAM_MAX_DEPTH 300
+// Seconds the beam may run before the staged solver takes over
+#define BEAM_TIME 0.5
+// Beam states are ranked mostly by misplaced stickers, then by the
+// pattern database distances
+#ifndef BEAM_STICKER_WEIGHT
+#define BEAM_STICKER_WEIGHT 16
+#endif
+// Rough size of a hash set entry
+#define BEAM_SEEN_BYTES 32
+
+static const int factorial[] = {1, 1, 2, 6, 24};
+
+// Commutators for the staged solver, from a computer search. Each moves
+// only two or three pieces of one size, and stays useful wherever setup
+// moves take those pieces.
+static const std::vector<std::vector<MoveCode> > macroMoves = {
+    // Flips two 2c pieces
+    {26, 2, 16, 20, 16, 24, 17, 21, 17, 25, 8, 15, 26, 16, 27, 14, 9, 17, 24, 17, 21, 17, 25, 17,
+     21, 8, 15, 26, 17, 27, 14, 9, 3, 27, 17, 21, 19, 21, 24, 21, 19, 21, 25, 6, 13, 29, 1, 28, 12,
+     7, 0, 24, 21, 19, 21, 25, 21, 19, 21, 1, 6, 13, 29, 0, 28, 12, 7, 17},
+    // Cycles three 2c pieces
+    {16, 20, 16, 24, 17, 21, 17, 25, 8, 15, 26, 16, 27, 14, 9, 17, 24, 17, 21, 17, 25, 17, 21, 8,
+     15, 26, 17, 27, 14, 9},
+    // Twists one 3c piece
+    {3, 27, 0, 16, 1, 17, 6, 13, 29, 1, 28, 12, 7, 0, 17, 0, 17, 1, 1, 6, 13, 29, 0, 28, 12, 7, 26,
+     2, 20, 27, 0, 16, 1, 17, 6, 13, 29, 1, 28, 12, 7, 0, 17, 0, 17, 1, 1, 6, 13, 29, 0, 28, 12, 7,
+     26, 21},
+    // Twists two 3c pieces
+    {0, 16, 1, 17, 9, 14, 27, 0, 26, 15, 8, 1, 17, 0, 17, 9, 14, 27, 1, 26, 15, 8},
+    // Cycles three 3c pieces
+    {6, 13, 29, 0, 28, 12, 7, 1, 20, 0, 6, 13, 29, 1, 28, 12, 7, 21},
+    // Cycles three 3c pieces and twists them
+    {15, 25, 6, 13, 29, 0, 28, 12, 7, 1, 20, 0, 6, 13, 29, 1, 28, 12, 7, 21, 8, 15, 26, 1, 27, 14,
+     9, 0, 18, 1, 8, 15, 26, 0, 27, 14, 9, 19, 24, 14},
+    // Twists one 4c piece
+    {3, 16, 0, 7, 1, 6, 3, 18, 2, 19, 7, 0, 6, 1, 19, 3, 19, 2, 17, 0, 14, 1, 15, 2, 18, 3, 19, 14,
+     0, 15, 1, 19, 2, 19, 25, 6, 24, 2, 21, 3, 21, 0, 12, 1, 13, 21, 2, 21, 3, 12, 0, 13, 1, 23, 3,
+     21, 2, 21, 0, 8, 1, 9, 21, 3, 21, 2, 8, 0, 9, 1, 23, 25, 7, 24},
+    // Twists two 4c pieces
+    {13, 24, 0, 6, 1, 7, 2, 18, 3, 19, 6, 0, 7, 1, 19, 2, 19, 3, 25, 2, 19, 3, 19, 0, 13, 1, 12, 19,
+     2, 19, 3, 13, 0, 12, 1, 12},
+    // Cycles three 4c pieces
+    {0, 6, 1, 7, 2, 18, 3, 19, 6, 0, 7, 1, 19, 2, 19, 3},
+    // Cycles three 4c pieces and twists them
+    {4, 16, 5, 18, 4, 17, 5, 19, 8, 16, 9, 18, 8, 17, 9, 4, 17, 5, 19, 4, 17, 5, 19, 8, 17, 9, 19,
+     8, 17, 9},
+};
+
+struct SolverTables {
+    std::array<int, NUM_SLOTS> size;
+    std::array<int, NUM_SLOTS> base;
+    // Index of each slot within the slots of its size
+    std::array<int, NUM_SLOTS> local;
+    std::array<unsigned char, NUM_STICKERS> stickerSlot;
+    // Piece codes after each move, by piece size
+    std::array<std::vector<std::array<unsigned short, NUM_MOVES> >, 5> codeMoves;
+    // Moves only change the slice config through the slice gyros, which
+    // leave every sticker in place
+    std::array<std::array<unsigned char, NUM_MOVES>, NUM_CONFIGS> nextConfig;
+    std::array<std::array<unsigned char, NUM_MOVES>, NUM_CONFIGS> sliceGyros;
+    // Move undoing each move, NUM_MOVES if there is none
+    std::array<MoveCode, NUM_MOVES> inverse;
+    // First move with the same permutation as each move, and whether two
+    // moves give the same result played in either order
+    std::array<MoveCode, NUM_MOVES> canonical;
+    std::array<std::array<bool, NUM_MOVES>, NUM_MOVES> commutes;
+    // Slice gyros leave every sticker where it is
+    std::array<bool, NUM_MOVES> configOnly;
+    // Every orientation of the solved puzzle
+    std::vector<PuzzleState> solvedStates;
+    // Orientation by the centers in the first few center slots, which are
+    // enough to tell them apart
+    std::vector<short> orientations;
+    std::vector<int> centers;
+    int orientationCenters;
+
+    SolverTables();
+};
+
+static const SolverTables& getTables() {
+    static SolverTables tables;
+    return tables;
+}
+
+SolverTables::SolverTables() {
+    for (int slot = 0; slot < NUM_SLOTS; slot++) {
+        size[slot] = PuzzleState::getSlotSize(slot);
+        base[slot] = PuzzleState::getSlotSticker(slot);
+        for (int i = 0; i < size[slot]; i++) {
+            stickerSlot[base[slot] + i] = slot;
+        }
+    }
+
+    std::array<std::array<unsigned char, NUM_STICKERS>, NUM_MOVES> destinations;
+    for (int move = 0; move < NUM_MOVES; move++) {
+        const unsigned char *perm = PuzzleState::getMovePermutation(move);
+        for (int i = 0; i < NUM_STICKERS; i++) {
+            destinations[move][perm[i]] = i;
+        }
+    }
+    for (int pieceSize = 1; pieceSize <= 4; pieceSize++) {
+        std::vector<int> orbit = PuzzleState::getOrbit(pieceSize);
+        for (size_t i = 0; i < orbit.size(); i++) {
+            local[orbit[i]] = i;
+        }
+        codeMoves[pieceSize].resize(orbit.size() * factorial[pieceSize]);
+        for (size_t code = 0; code < codeMoves[pieceSize].size(); code++) {
+            int slot = orbit[code / factorial[pieceSize]];
+            unsigned char offsets[4];
+            PuzzleState::unrankPermutation(code % factorial[pieceSize], offsets, pieceSize);
+            for (int move = 0; move < NUM_MOVES; move++) {
+                unsigned char moved[4];
+                for (int i = 0; i < pieceSize; i++) {
+                    moved[i] = destinations[move][base[slot] + offsets[i]];
+                }
+                int newSlot = stickerSlot[moved[0]];
+                for (int i = 0; i < pieceSize; i++) {
+                    moved[i] -= base[newSlot];
+                }
+                codeMoves[pieceSize][code][move] = local[newSlot] * factorial[pieceSize] +
+                                                   PuzzleState::rankPermutation(moved, pieceSize);
+            }
+        }
+    }
+
+    for (int config = 0; config < NUM_CONFIGS; config++) {
+        for (int move = 0; move < NUM_MOVES; move++) {
+            sliceGyros[config][move] = PuzzleState::getMacro(config, move).size() - 1;
+            nextConfig[config][move] = PuzzleState::getNextConfig(config, move);
+        }
+    }
+
+    for (int move = 0; move < NUM_MOVES; move++) {
+        inverse[move] = NUM_MOVES;
+        for (int other = 0; other < NUM_MOVES; other++) {
+            PuzzleState state;
+            state.applyMove(move);
+            state.applyMove(other);
+            if (state.stickers == PuzzleState().stickers) {
+                inverse[move] = other;
+                break;
+            }
+        }
+    }
+
+    for (int move = 0; move < NUM_MOVES; move++) {
+        PuzzleState state;
+        state.applyMove(move);
+        configOnly[move] = state.stickers == PuzzleState().stickers;
+        canonical[move] = move;
+        for (int other = 0; other < NUM_MOVES; other++) {
+            PuzzleState first, second;
+            first.applyMove(move);
+            first.applyMove(other);
+            second.applyMove(other);
+            second.applyMove(move);
+            commutes[move][other] = first.stickers == second.stickers;
+            PuzzleState moved, otherMoved;
+            moved.applyMove(move);
+            otherMoved.applyMove(other);
+            if (other < canonical[move] && moved.stickers == otherMoved.stickers) canonical[move] = other;
+        }
+    }
+
+    // Moves that keep the puzzle solved only reorient it
+    std::set<std::array<unsigned char, NUM_STICKERS> > seen;
+    solvedStates.push_back(PuzzleState());
+    seen.insert(solvedStates[0].stickers);
+    for (size_t i = 0; i < solvedStates.size(); i++) {
+        for (int move = 0; move < NUM_MOVES; move++) {
+            PuzzleState state = solvedStates[i];
+            state.applyMove(move);
+            if (state.isSolved() && seen.insert(state.stickers).second) {
+                solvedStates.push_back(state);
+            }
+        }
+    }
+
+    centers = PuzzleState::getOrbit(1);
+    std::vector<std::vector<int> > keys(solvedStates.size());
+    for (size_t i = 0; i < solvedStates.size(); i++) {
+        for (size_t j = 0; j < centers.size(); j++) {
+            keys[i].push_back(local[stickerSlot[solvedStates[i].stickers[base[centers[j]]]]]);
+        }
+    }
+    for (orientationCenters = 1; orientationCenters <= (int)centers.size(); orientationCenters++) {
+        orientations.assign((size_t)std::pow(centers.size(), orientationCenters), -1);
+        bool unique = true;
+        for (size_t i = 0; i < keys.size() && unique; i++) {
+            size_t index = 0;
+            for (int j = 0; j < orientationCenters; j++) {
+                index = index * centers.size() + keys[i][j];
+            }
+            unique = orientations[index] == -1;
+            orientations[index] = i;
+        }
+        if (unique) break;
+    }
+}
+
+// Layout of a saved table. Every field is checked before the data is used.
+struct DatabaseHeader {
+    char magic[8];
+    unsigned int version;
+    unsigned int coreVersion;
+    int turn;
+    int gyro;
+    int rotate;
+    unsigned int numGoals;
+    unsigned int numPieces;
+    unsigned int pieces[MAX_DATABASE_PIECES];
+    unsigned int maxDistance;
+    unsigned long long size;
+    unsigned long long dataOffset;
+    unsigned long long checksum;
+};
+
+// FNV-1a
+static unsigned long long getChecksum(const unsigned char* data, size_t size) {
+    unsigned long long hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+SolverMetric SolverMetric::turnMetric() {
+    SolverMetric metric = {1, 1, 0, 0};
+    return metric;
+}
+
+SolverMetric SolverMetric::physicalMetric() {
+    SolverMetric metric = {1, 1, 1, 0};
+    return metric;
+}
+
+PatternDatabase::PatternDatabase(const std::vector<int>& pieces, const std::vector<PuzzleState>& goals,
+                                 const SolverMetric& metric) : PatternDatabase(pieces) {
+    const SolverTables& tables = getTables();
+    this->metric = metric;
+    numGoals = goals.size();
+    std::vector<unsigned char> distances(size, UNREACHED);
+
+    // Moves that do the same as another only need expanding once
+    std::vector<MoveCode> moves = MoveAutomaton(Solver::getSearchMoves(metric)).getMoves(MoveAutomaton::getStart());
+    std::vector<int> costs;
+    for (size_t i = 0; i < moves.size(); i++) {
+        if (moves[i] < MOVE_GYRO) {
+            costs.push_back(metric.turn);
+        } else {
+            costs.push_back(moves[i] < MOVE_GYRO_OUTER ? metric.gyro : metric.rotate);
+        }
+    }
+
+    // Breadth first by distance, one bucket per distance
+    std::vector<std::vector<unsigned int> > buckets(1);
+    std::vector<unsigned short> codes(pieces.size());
+    for (size_t i = 0; i < goals.size(); i++) {
+        for (size_t j = 0; j < pieces.size(); j++) {
+            codes[j] = getPieceCode(goals[i], pieces[j]);
+        }
+        size_t index = getIndex(codes.data());
+        if (distances[index] == 0) continue;
+        distances[index] = 0;
+        buckets[0].push_back(index);
+    }
+    maxDistance = 0;
+    for (size_t distance = 0; distance < buckets.size(); distance++) {
+        for (size_t i = 0; i < buckets[distance].size(); i++) {
+            size_t index = buckets[distance][i];
+            if (distances[index] != distance) continue;
+            maxDistance = distance;
+            for (size_t j = 0; j < pieces.size(); j++) {
+                codes[j] = index / placeValues[j] % getNumPieceCodes(pieces[j]);
+            }
+            for (size_t m = 0; m < moves.size(); m++) {
+                size_t next = 0;
+                for (size_t j = 0; j < pieces.size(); j++) {
+                    next += tables.codeMoves[tables.size[pieces[j]]][codes[j]][moves[m]] * placeValues[j];
+                }
+                // Capping keeps the distances lower bounds
+                size_t nextDistance = std::min<size_t>(distance + costs[m], UNREACHED - 1);
+                if (nextDistance >= distances[next]) continue;
+                distances[next] = nextDistance;
+                if (buckets.size() <= nextDistance) buckets.resize(nextDistance + 1);
+                buckets[nextDistance].push_back(next);
+            }
+        }
+        std::vector<unsigned int>().swap(buckets[distance]);
+    }
+
+    packed.assign((size + 1) / 2, 0);
+    for (size_t i = 0; i < size; i++) {
+        packed[i / 2] |= std::min<int>(distances[i], MAX_PACKED_DISTANCE) << (i % 2 * 4);
+    }
+    table = packed.data();
+}
+
+PatternDatabase::PatternDatabase(const std::vector<int>& pieces) : pieces(pieces) {
+    placeValues.resize(pieces.size());
+    size = 1;
+    for (size_t i = pieces.size(); i-- > 0;) {
+        placeValues[i] = size;
+        size *= getNumPieceCodes(pieces[i]);
+    }
+    metric = SolverMetric();
+    numGoals = 0;
+    maxDistance = 0;
+    table = NULL;
+    mapping = NULL;
+    mappingSize = 0;
+}
+
+PatternDatabase::~PatternDatabase() {
+    if (mapping == NULL) return;
+#ifdef _WIN32
+    UnmapViewOfFile(mapping);
+#else
+    munmap(mapping, mappingSize);
+#endif
+}
+
+const std::vector<int>& PatternDatabase::getPieces() const {
+    return pieces;
+}
+
+size_t PatternDatabase::getSize() const {
+    return size;
+}
+
+int PatternDatabase::getMaxDistance() const {
+    return maxDistance;
+}
+
+size_t PatternDatabase::getIndex(const unsigned short* codes) const {
+    size_t index = 0;
+    for (size_t i = 0; i < pieces.size(); i++) {
+        index += codes[i] * placeValues[i];
+    }
+    return index;
+}
+
+bool PatternDatabase::save(const std::string& filename) const {
+    DatabaseHeader header;
+    memset(&header, 0, sizeof(header));
+    if (pieces.size() > MAX_DATABASE_PIECES) return false;
+    strcpy(header.magic, DATABASE_MAGIC);
+    header.version = DATABASE_VERSION;
+    header.coreVersion = PUZZLE_CORE_VERSION;
+    header.turn = metric.turn;
+    header.gyro = metric.gyro;
+    header.rotate = metric.rotate;
+    header.numGoals = numGoals;
+    header.numPieces = pieces.size();
+    for (size_t i = 0; i < pieces.size(); i++) {
+        header.pieces[i] = pieces[i];
+    }
+    header.maxDistance = maxDistance;
+    header.size = size;
+    header.dataOffset = DATABASE_DATA_OFFSET;
+    header.checksum = getChecksum(table, (size + 1) / 2);
+
+    // Written under another name first so readers never map half a file
+    std::string partial = filename + ".part";
+    FILE *file = fopen(partial.c_str(), "wb");
+    if (file == NULL) return false;
+    std::vector<char> padding(DATABASE_DATA_OFFSET - sizeof(header), 0);
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   fwrite(padding.data(), padding.size(), 1, file) == 1 &&
+                   fwrite(table, (size + 1) / 2, 1, file) == 1;
+    written = fclose(file) == 0 && written;
+    if (written) {
+        remove(filename.c_str());
+        written = rename(partial.c_str(), filename.c_str()) == 0;
+    }
+    if (!written) remove(partial.c_str());
+    return written;
+}
+
+PatternDatabase* PatternDatabase::load(const std::string& filename, const std::vector<int>& pieces,
+                                       const std::vector<PuzzleState>& goals, const SolverMetric& metric) {
+    void *mapping = NULL;
+    size_t mappingSize = 0;
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+    LARGE_INTEGER fileSize;
+    if (GetFileSizeEx(file, &fileSize)) {
+        mappingSize = fileSize.QuadPart;
+        HANDLE fileMapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (fileMapping != NULL) {
+            // The view keeps the mapping alive
+            mapping = MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(fileMapping);
+        }
+    }
+    CloseHandle(file);
+#else
+    int file = open(filename.c_str(), O_RDONLY);
+    if (file < 0) return NULL;
+    struct stat status;
+    if (fstat(file, &status) == 0 && status.st_size > 0) {
+        mappingSize = status.st_size;
+        mapping = mmap(NULL, mappingSize, PROT_READ, MAP_SHARED, file, 0);
+        if (mapping == MAP_FAILED) mapping = NULL;
+    }
+    close(file);
+#endif
+    if (mapping == NULL) return NULL;
+
+    PatternDatabase *database = new PatternDatabase(pieces);
+    database->mapping = mapping;
+    database->mappingSize = mappingSize;
+    DatabaseHeader header;
+    if (mappingSize < DATABASE_DATA_OFFSET) {
+        delete database;
+        return NULL;
+    }
+    memcpy(&header, mapping, sizeof(header));
+    bool valid = memcmp(header.magic, DATABASE_MAGIC, sizeof(DATABASE_MAGIC)) == 0 &&
+                 header.version == DATABASE_VERSION &&
+                 header.coreVersion == PUZZLE_CORE_VERSION &&
+                 header.turn == metric.turn && header.gyro == metric.gyro && header.rotate == metric.rotate &&
+                 header.numGoals == goals.size() &&
+                 header.numPieces == pieces.size() &&
+                 header.size == database->size &&
+                 header.dataOffset == DATABASE_DATA_OFFSET &&
+                 mappingSize == DATABASE_DATA_OFFSET + (database->size + 1) / 2;
+    for (size_t i = 0; i < pieces.size() && valid; i++) {
+        valid = header.pieces[i] == (unsigned int)pieces[i];
+    }
+    if (valid) {
+        database->table = (const unsigned char*)mapping + DATABASE_DATA_OFFSET;
+        database->maxDistance = header.maxDistance;
+        valid = getChecksum(database->table, (database->size + 1) / 2) == header.checksum;
+    }
+    if (!valid) {
+        delete database;
+        return NULL;
+    }
+    database->metric = metric;
+    database->numGoals = goals.size();
+    return database;
+}
+
+bool PatternDatabase::isMapped() const {
+    return mapping != NULL;
+}
+
+std::string PatternDatabase::getFileName(const std::vector<int>& pieces, const SolverMetric& metric) {
+    std::string name = "3to4++-" + std::to_string(metric.turn) + "-" + std::to_string(metric.gyro) + "-" +
+                       std::to_string(metric.rotate);
+    for (size_t i = 0; i < pieces.size(); i++) {
+        name += "-" + std::to_string(pieces[i]);
+    }
+    return name + ".pdb";
+}
+
+unsigned short PatternDatabase::getPieceCode(const PuzzleState& state, int piece) {
+    const SolverTables& tables = getTables();
+    int pieceSize = tables.size[piece];
+    unsigned char positions[4];
+    for (int i = 0; i < NUM_STICKERS; i++) {
+        int offset = state.stickers[i] - tables.base[piece];
+        if (offset >= 0 && offset < pieceSize) positions[offset] = i;
+    }
+    int slot = tables.stickerSlot[positions[0]];
+    for (int i = 0; i < pieceSize; i++) {
+        positions[i] -= tables.base[slot];
+    }
+    return tables.local[slot] * factorial[pieceSize] + PuzzleState::rankPermutation(positions, pieceSize);
+}
+
+unsigned short PatternDatabase::movePieceCode(int piece, unsigned short code, MoveCode move) {
+    const SolverTables& tables = getTables();
+    return tables.codeMoves[tables.size[piece]][code][move];
+}
+
+int PatternDatabase::getNumPieceCodes(int piece) {
+    const SolverTables& tables = getTables();
+    return tables.codeMoves[tables.size[piece]].size();
+}
+
+// Stickers away from where the centers say they belong
+static int getMisplaced(const PuzzleState& state) {
+    const SolverTables& tables = getTables();
+    size_t index = 0;
+    for (int j = 0; j < tables.orientationCenters; j++) {
+        int label = state.stickers[tables.base[tables.centers[j]]];
+        index = index * tables.centers.size() + tables.local[tables.stickerSlot[label]];
+    }
+    const PuzzleState& solved = tables.solvedStates[tables.orientations[index]];
+    int misplaced = 0;
+    for (int i = 0; i < NUM_STICKERS; i++) {
+        misplaced += state.stickers[i] != solved.stickers[i];
+    }
+    return misplaced;
+}
+
+// Whether the 2c pieces are arranged by an odd permutation
+static bool isOdd(const PuzzleState& state) {
+    const SolverTables& tables = getTables();
+    std::vector<int> orbit = PuzzleState::getOrbit(2);
+    std::vector<bool> visited(NUM_SLOTS, false);
+    bool odd = false;
+    for (size_t i = 0; i < orbit.size(); i++) {
+        if (visited[orbit[i]]) continue;
+        // A cycle of n pieces takes n - 1 swaps
+        for (int slot = tables.stickerSlot[state.stickers[tables.base[orbit[i]]]]; !visited[slot];
+             slot = tables.stickerSlot[state.stickers[tables.base[slot]]]) {
+            visited[slot] = true;
+            odd = !odd;
+        }
+        odd = !odd;
+    }
+    return odd;
+}
+
+Solver::Solver(SolverMetric metric, const std::string& databaseDirectory) :
+    metric(metric), moves(getSearchMoves(metric)), automaton(moves) {
+    // Free moves would let IDA* wander forever
+    this->metric.turn = std::max(this->metric.turn, 1);
+    this->metric.gyro = std::max(this->metric.gyro, 1);
+    this->metric.sliceGyro = std::max(this->metric.sliceGyro, 0);
+
+    const SolverTables& tables = getTables();
+    std::vector<std::vector<int> > groups = getDatabasePieces(!databaseDirectory.empty());
+    for (size_t i = 0; i < groups.size(); i++) {
+        PatternDatabase *database = NULL;
+        if (!databaseDirectory.empty()) {
+            std::string filename = databaseDirectory + "/" + PatternDatabase::getFileName(groups[i], this->metric);
+            database = PatternDatabase::load(filename, groups[i], tables.solvedStates, this->metric);
+        }
+        if (database == NULL) {
+            database = new PatternDatabase(groups[i], tables.solvedStates, this->metric);
+        }
+        databases.push_back(database);
+        tracked.insert(tracked.end(), groups[i].begin(), groups[i].end());
+    }
+    threads = 1;
+    nodes = 0;
+    nodeLimit = 0;
+    currentBound = 0;
+    cancel = NULL;
+    stopped = false;
+    found = false;
+    splitDepth = 0;
+    iteration = 0;
+    beamWidth = BEAM_WIDTH;
+    beamMemory = BEAM_MEMORY;
+
+    // Each macro and its inverse
+    for (size_t i = 0; i < macroMoves.size(); i++) {
+        for (int inverted = 0; inverted < 2; inverted++) {
+            Macro macro;
+            macro.moves = macroMoves[i];
+            if (inverted) {
+                std::reverse(macro.moves.begin(), macro.moves.end());
+                for (size_t j = 0; j < macro.moves.size(); j++) {
+                    macro.moves[j] = tables.inverse[macro.moves[j]];
+                }
+            }
+            PuzzleState state;
+            for (size_t j = 0; j < macro.moves.size(); j++) {
+                state.applyMove(macro.moves[j]);
+            }
+            macro.twists = false;
+            for (int slot = 0; slot < NUM_SLOTS; slot++) {
+                int home = tables.stickerSlot[state.stickers[tables.base[slot]]];
+                if (state.stickers[tables.base[slot]] == tables.base[slot]) {
+                    for (int j = 1; j < tables.size[slot]; j++) {
+                        if (state.stickers[tables.base[slot] + j] != tables.base[slot] + j) {
+                            macro.slots.push_back(slot);
+                            macro.twists = true;
+                            break;
+                        }
+                    }
+                } else {
+                    macro.slots.push_back(slot);
+                    if (home == slot) macro.twists = true;
+                }
+            }
+            macros.push_back(macro);
+        }
+    }
+}
+
+Solver::~Solver() {
+    for (size_t i = 0; i < databases.size(); i++) {
+        delete databases[i];
+    }
+}
+
+bool Solver::solveOptimal(const PuzzleState& state, std::vector<MoveCode>& solution, unsigned long long maxNodes) {
+    nodes = 0;
+    nodeLimit = maxNodes;
+    return runSearch(state, solution);
+}
+
+bool Solver::solveStaged(const PuzzleState& state, std::vector<MoveCode>& solution) {
+    const SolverTables& tables = getTables();
+    if (solveOptimal(state, solution, STAGED_SEARCH_NODES)) return true;
+    solution.clear();
+
+    // The centers always sit like those of some solved orientation. Relabel
+    // the stickers so that orientation is the identity and solve towards it.
+    std::vector<int> centers = PuzzleState::getOrbit(1);
+    const PuzzleState *goal = NULL;
+    for (size_t i = 0; i < tables.solvedStates.size() && goal == NULL; i++) {
+        goal = &tables.solvedStates[i];
+        for (size_t j = 0; j < centers.size(); j++) {
+            if (PatternDatabase::getPieceCode(state, centers[j]) !=
+                PatternDatabase::getPieceCode(*goal, centers[j])) {
+                goal = NULL;
+                break;
+            }
+        }
+    }
+    if (goal == NULL) return false;
+    std::array<unsigned char, NUM_STICKERS> relabel;
+    for (int i = 0; i < NUM_STICKERS; i++) {
+        relabel[goal->stickers[i]] = i;
+    }
+    PuzzleState current = state;
+    for (int i = 0; i < NUM_STICKERS; i++) {
+        current.stickers[i] = relabel[current.stickers[i]];
+    }
+
+    // 3-cycles are even, so fix an odd arrangement with one move first. The
+    // 2c and 3c arrangements are always both odd or both even, and the 4c
+    // arrangement is always even.
+    for (size_t i = 0; i < moves.size() && isOdd(current); i++) {
+        PuzzleState next = current;
+        next.applyMove(moves[i]);
+        if (!isOdd(next)) {
+            solution.push_back(moves[i]);
+            current = next;
+        }
+    }
+
+    while (!isCancelled() && playMacro(current, false, solution));
+    while (!isCancelled() && playMacro(current, true, solution));
+    if (isCancelled() || current.stickers != PuzzleState().stickers) return false;
+    simplify(state, solution);
+    return true;
+}
+
+bool Solver::solveBeam(const PuzzleState& state, std::vector<MoveCode>& solution) {
+    solution.clear();
+    nodes = 0;
+    stopped = isCancelled();
+
+    // Half the memory holds two depths of nodes and the children between
+    // them, the other half the states already kept and the way back
+    size_t nodeBytes = 2 * (sizeof(BeamNode) + tracked.size() * sizeof(unsigned short)) +
+                       moves.size() * sizeof(BeamChild);
+    size_t width = std::max<size_t>(1, std::min(beamWidth, beamMemory / 2 / nodeBytes));
+    size_t seenLimit = beamMemory / 4 / BEAM_SEEN_BYTES;
+
+    std::vector<BeamNode> beam(1);
+    beam[0].state = state;
+    for (size_t i = 0; i < tracked.size(); i++) {
+        beam[0].codes.push_back(PatternDatabase::getPieceCode(state, tracked[i]));
+    }
+    beam[0].sequence = MoveAutomaton::getStart();
+    // Node of the last depth each kept node came from, and the move
+    std::vector<std::vector<std::pair<unsigned int, MoveCode> > > steps;
+    std::unordered_set<unsigned long long> seen;
+    seen.insert(getHash(state));
+    int bestDistance = getMisplaced(state) * BEAM_STICKER_WEIGHT + getDistance(beam[0].codes);
+    size_t bestDepth = 0;
+    size_t bestIndex = 0;
+    bool solved = state.isSolved();
+    int stall = 0;
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                               std::chrono::duration<double>(BEAM_TIME));
+    for (size_t depth = 1; depth <= BEAM_MAX_DEPTH && !solved && stall < BEAM_STALL && !stopped &&
+                           std::chrono::steady_clock::now() < deadline;
+         depth++) {
+        // Each thread expands its share of the beam
+        size_t share = (beam.size() + threads - 1) / threads;
+        std::vector<std::vector<BeamChild> > shares(threads);
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < threads && i * share < beam.size(); i++) {
+            workers.push_back(std::thread(&Solver::expandBeam, this, std::cref(beam), i * share,
+                                          std::min(beam.size(), (i + 1) * share), std::ref(shares[i])));
+        }
+        expandBeam(beam, 0, std::min(beam.size(), share), shares[0]);
+        for (size_t i = 0; i < workers.size(); i++) {
+            workers[i].join();
+        }
+        std::vector<BeamChild> children;
+        for (size_t i = 0; i < shares.size(); i++) {
+            children.insert(children.end(), shares[i].begin(), shares[i].end());
+        }
+        nodes += children.size();
+        if (isCancelled()) stopped = true;
+
+        // Closest first. The same state always has the same distance, so
+        // ordering ties by hash puts copies next to each other.
+        std::sort(children.begin(), children.end(), [](const BeamChild& a, const BeamChild& b) {
+            return a.distance != b.distance ? a.distance < b.distance : a.hash < b.hash;
+        });
+        if (seen.size() + width > seenLimit) seen.clear();
+        std::vector<BeamNode> next;
+        steps.push_back(std::vector<std::pair<unsigned int, MoveCode> >());
+        stall++;
+        for (size_t i = 0; i < children.size() && next.size() < width && !solved; i++) {
+            const BeamChild& child = children[i];
+            if (!seen.insert(child.hash).second) continue;
+            const BeamNode& parent = beam[child.parent];
+            BeamNode node;
+            node.state = parent.state;
+            node.state.applyMove(child.move);
+            node.codes.resize(tracked.size());
+            for (size_t j = 0; j < tracked.size(); j++) {
+                node.codes[j] = PatternDatabase::movePieceCode(tracked[j], parent.codes[j], child.move);
+            }
+            node.sequence = automaton.getNext(parent.sequence, child.move);
+            solved = child.distance == 0 && node.state.isSolved();
+            if (child.distance < bestDistance || solved) {
+                bestDistance = child.distance;
+                bestDepth = depth;
+                bestIndex = next.size();
+                stall = 0;
+            }
+            steps.back().push_back(std::make_pair(child.parent, child.move));
+            next.push_back(node);
+        }
+        beam.swap(next);
+    }
+    if (stopped && !solved) return false;
+
+    // Walk back from the closest state and let the staged solver finish
+    PuzzleState current = state;
+    for (size_t depth = bestDepth, index = bestIndex; depth > 0; depth--) {
+        solution.push_back(steps[depth - 1][index].second);
+        index = steps[depth - 1][index].first;
+    }
+    std::reverse(solution.begin(), solution.end());
+    for (size_t i = 0; i < solution.size(); i++) {
+        current.applyMove(solution[i]);
+    }
+    if (current.isSolved()) return true;
+    std::vector<MoveCode> rest;
+    if (!solveStaged(current, rest)) return false;
+    solution.insert(solution.end(), rest.begin(), rest.end());
+    simplify(state, solution);
+    return true;
+}
+
+bool Solver::getScramble(const PuzzleState& state, std::vector<MoveCode>& scramble) {
+    const SolverTables& tables = getTables();
+    std::vector<MoveCode> solution;
+    if (!solveStaged(state, solution)) return false;
+    PuzzleState end = state;
+    for (size_t i = 0; i < solution.size(); i++) {
+        end.applyMove(solution[i]);
+    }
+
+    // Staged solutions end in whichever orientation the centers were in, so
+    // find the gyros reorienting solved to it, breadth first
+    std::vector<PuzzleState> states(1, PuzzleState());
+    std::vector<size_t> parents(1, 0);
+    std::vector<MoveCode> gyros(1, NUM_MOVES);
+    std::set<std::array<unsigned char, NUM_STICKERS> > seen;
+    seen.insert(states[0].stickers);
+    size_t found = 0;
+    for (size_t i = 0; i < states.size() && states[found].stickers != end.stickers; i++) {
+        for (int move = MOVE_GYRO; move < MOVE_GYRO_OUTER; move++) {
+            PuzzleState next = states[i];
+            next.applyMove(move);
+            if (!seen.insert(next.stickers).second) continue;
+            if (next.stickers == end.stickers) found = states.size();
+            states.push_back(next);
+            parents.push_back(i);
+            gyros.push_back(move);
+        }
+    }
+    if (states[found].stickers != end.stickers) return false;
+
+    scramble.clear();
+    for (size_t i = found; i != 0; i = parents[i]) {
+        scramble.push_back(gyros[i]);
+    }
+    std::reverse(scramble.begin(), scramble.end());
+    for (size_t i = solution.size(); i > 0; i--) {
+        scramble.push_back(tables.inverse[solution[i - 1]]);
+    }
+    return true;
+}
+
+unsigned long long Solver::getNodes() const {
+    return nodes;
+}
+
+int Solver::getBound() const {
+    return currentBound;
+}
+
+void Solver::setThreads(unsigned int threads) {
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    this->threads = std::max(threads, 1U);
+}
+
+void Solver::setCancelFlag(const std::atomic<bool>* cancel) {
+    this->cancel = cancel;
+}
+
+void Solver::setBeamWidth(size_t width) {
+    beamWidth = std::max<size_t>(width, 1);
+}
+
+void Solver::setBeamMemory(size_t bytes) {
+    beamMemory = bytes;
+}
+
+bool Solver::saveDatabases(const std::string& directory) const {
+    for (size_t i = 0; i < databases.size(); i++) {
+        if (databases[i]->isMapped()) continue;
+        std::string filename = directory + "/" + PatternDatabase::getFileName(databases[i]->getPieces(), metric);
+        if (!databases[i]->save(filename)) return false;
+    }
+    return true;
+}
+
+int Solver::getCost(const PuzzleState& state, const std::vector<MoveCode>& solution) const {
+    const SolverTables& tables = getTables();
+    int config = state.config;
+    int cost = 0;
+    for (size_t i = 0; i < solution.size(); i++) {
+        cost += getMoveCost(config, solution[i]);
+        config = tables.nextConfig[config][solution[i]];
+    }
+    return cost;
+}
+
+void Solver::simplify(const PuzzleState& state, std::vector<MoveCode>& solution) {
+    const SolverTables& tables = getTables();
+    std::vector<MoveCode> kept;
+    // Next move last, so merged moves can be put back in front
+    std::vector<MoveCode> pending(solution.rbegin(), solution.rend());
+    while (!pending.empty()) {
+        MoveCode move = pending.back();
+        pending.pop_back();
+        if (tables.configOnly[move]) continue;
+        MoveCode inverse = tables.inverse[move];
+        // Look back past the moves it commutes with
+        size_t i = kept.size();
+        while (i > 0 && tables.commutes[kept[i - 1]][move] && tables.canonical[kept[i - 1]] != tables.canonical[move] &&
+               (inverse == NUM_MOVES || tables.canonical[kept[i - 1]] != tables.canonical[inverse])) {
+            i--;
+        }
+        if (inverse == NUM_MOVES) {
+            kept.push_back(move);
+        } else if (i > 0 && tables.canonical[kept[i - 1]] == tables.canonical[inverse]) {
+            kept.erase(kept.begin() + i - 1);
+        } else if (i > 1 && tables.canonical[kept[i - 1]] == tables.canonical[move] &&
+                   tables.canonical[kept[i - 2]] == tables.canonical[move]) {
+            // Three quarter turns are one the other way
+            kept.erase(kept.begin() + i - 2, kept.begin() + i);
+            pending.push_back(inverse);
+        } else {
+            kept.push_back(move);
+        }
+    }
+
+    // Anything after the puzzle is first solved only turns it around
+    PuzzleState current = state;
+    size_t length = 0;
+    while (length < kept.size() && !current.isSolved()) {
+        current.applyMove(kept[length++]);
+    }
+    kept.resize(length);
+    solution.swap(kept);
+}
+
+std::vector<MoveEntry> Solver::getMoveEntries(const PuzzleState& state, const std::vector<MoveCode>& solution) {
+    std::vector<MoveEntry> entries;
+    PuzzleState current = state;
+    for (size_t i = 0; i < solution.size(); i++) {
+        std::vector<MoveCode> codes(1, solution[i]);
+        if (solution[i] < MOVE_GYRO_OUTER) codes = current.expandMove(solution[i]);
+        for (size_t j = 0; j < codes.size(); j++) {
+            entries.push_back(current.getMoveEntry(codes[j]));
+            current.applyMove(codes[j]);
+        }
+    }
+    return entries;
+}
+
+std::vector<std::vector<int> > Solver::getDatabasePieces(bool large) {
+    // Triples of 4c pieces take 28 MB each and a while to build
+    size_t groupSize = large ? 3 : 2;
+    std::vector<std::vector<int> > groups;
+    for (int pieceSize = 2; pieceSize <= 4; pieceSize++) {
+        std::vector<int> orbit = PuzzleState::getOrbit(pieceSize);
+        for (size_t i = 0; i < orbit.size(); i += groupSize) {
+            size_t end = std::min(orbit.size(), i + groupSize);
+            groups.push_back(std::vector<int>(orbit.begin() + i, orbit.begin() + end));
+        }
+    }
+    return groups;
+}
+
+std::vector<MoveCode> Solver::getSearchMoves(const SolverMetric& metric) {
+    std::vector<MoveCode> moves;
+    for (int move = 0; move < MOVE_GYRO_OUTER; move++) {
+        moves.push_back(move);
+    }
+    if (metric.rotate > 0) {
+        moves.push_back(MOVE_ROTATE);
+        moves.push_back(MOVE_ROTATE + 1);
+    }
+    return moves;
+}
+
+const std::vector<PuzzleState>& Solver::getSolvedStates() {
+    return getTables().solvedStates;
+}
+
+int Solver::getMoveCost(int config, MoveCode move) const {
+    const SolverTables& tables = getTables();
+    int cost;
+    if (move < MOVE_GYRO) {
+        cost = metric.turn;
+    } else if (move < MOVE_GYRO_OUTER) {
+        cost = metric.gyro;
+    } else {
+        cost = metric.rotate;
+    }
+    return cost + metric.sliceGyro * tables.sliceGyros[config][move];
+}
+
+bool Solver::runSearch(const PuzzleState& state, std::vector<MoveCode>& solution) {
+    size_t tableSize = (size_t)1 << TRANSPOSITION_BITS;
+    if (!transpositions) {
+        transpositions.reset(new std::atomic<unsigned long long>[tableSize]);
+        for (size_t i = 0; i < tableSize; i++) {
+            transpositions[i] = 0;
+        }
+    }
+    // Split just deep enough to keep every thread busy
+    splitDepth = 0;
+    for (size_t tasks = 1; threads > 1 && tasks < threads * TASKS_PER_THREAD; tasks *= moves.size() - 1) {
+        splitDepth++;
+    }
+    stopped = isCancelled();
+    found = false;
+
+    SearchStack stack;
+    startStack(stack, state, 0);
+    int bound = heuristic(stack.codes[0]);
+    while (bound < UNREACHED) {
+        currentBound = bound;
+        // Older entries only need to differ from this iteration
+        iteration = (iteration + 1) & TRANSPOSITION_FIELD_MASK;
+        if (iteration == 0) {
+            for (size_t i = 0; i < tableSize; i++) {
+                transpositions[i] = 0;
+            }
+            iteration = 1;
+        }
+
+        // Search the first few moves here, then share the subtrees below
+        // them out between the threads
+        startStack(stack, state, bound);
+        std::vector<SearchTask> tasks;
+        int next = search(stack, 0, 0, bound, threads > 1 ? &tasks : NULL);
+        countNodes(stack);
+        if (next == FOUND) {
+            foundPath = stack.path;
+            found = true;
+        }
+        std::atomic<int> minimum(next);
+        if (!found && !tasks.empty()) {
+            std::vector<TaskQueue> queues(threads);
+            for (size_t i = 0; i < tasks.size(); i++) {
+                queues[i % threads].tasks.push_back(tasks[i]);
+            }
+            for (size_t i = 0; i < queues.size(); i++) {
+                queues[i].front = 0;
+            }
+            // This thread takes the first queue
+            std::vector<std::thread> workers;
+            for (size_t i = 1; i < queues.size(); i++) {
+                workers.push_back(std::thread(&Solver::runTasks, this, std::cref(state), bound,
+                                              std::ref(queues), i, std::ref(minimum)));
+            }
+            runTasks(state, bound, queues, 0, minimum);
+            for (size_t i = 0; i < workers.size(); i++) {
+                workers[i].join();
+            }
+        }
+        if (found) {
+            solution = foundPath;
+            return true;
+        }
+        if (stopped) break;
+        bound = minimum;
+    }
+    return false;
+}
+
+void Solver::runTasks(const PuzzleState& state, int bound, std::vector<TaskQueue>& queues, size_t queue,
+                      std::atomic<int>& minimum) {
+    SearchStack stack;
+    startStack(stack, state, bound);
+    SearchTask task;
+    while (!stopped && takeTask(queues, queue, task)) {
+        stack.path.clear();
+        for (size_t i = 0; i < task.path.size(); i++) {
+            playMove(stack, i, task.path[i]);
+            stack.path.push_back(task.path[i]);
+            stack.sequences[i + 1] = automaton.getNext(stack.sequences[i], task.path[i]);
+        }
+        int next = search(stack, task.path.size(), task.cost, bound, NULL);
+        if (next == FOUND) {
+            std::lock_guard<std::mutex> lock(solutionMutex);
+            if (!found) {
+                foundPath = stack.path;
+                found = true;
+            }
+            stopped = true;
+            break;
+        }
+        int current = minimum;
+        while (next < current && !minimum.compare_exchange_weak(current, next));
+    }
+    countNodes(stack);
+}
+
+bool Solver::takeTask(std::vector<TaskQueue>& queues, size_t queue, SearchTask& task) {
+    {
+        TaskQueue& own = queues[queue];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (own.front < own.tasks.size()) {
+            task = own.tasks.back();
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t i = 1; i < queues.size(); i++) {
+        TaskQueue& other = queues[(queue + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(other.mutex);
+        if (other.front < other.tasks.size()) {
+            task = other.tasks[other.front++];
+            return true;
+        }
+    }
+    return false;
+}
+
+void Solver::startStack(SearchStack& stack, const PuzzleState& state, int bound) const {
+    // Every move costs at least 1, so this is as deep as the search goes
+    stack.states.assign(bound + 2, state);
+    stack.codes.resize(1);
+    stack.codes[0].clear();
+    for (size_t i = 0; i < tracked.size(); i++) {
+        stack.codes[0].push_back(PatternDatabase::getPieceCode(state, tracked[i]));
+    }
+    stack.codes.resize(bound + 2, stack.codes[0]);
+    stack.path.clear();
+    stack.sequences.assign(bound + 2, MoveAutomaton::getStart());
+    stack.nodes = 0;
+}
+
+void Solver::playMove(SearchStack& stack, int depth, MoveCode move) const {
+    const SolverTables& tables = getTables();
+    const PuzzleState& state = stack.states[depth];
+    PuzzleState& child = stack.states[depth + 1];
+    const unsigned char *perm = PuzzleState::getMovePermutation(move);
+    for (int i = 0; i < NUM_STICKERS; i++) {
+        child.stickers[i] = state.stickers[perm[i]];
+    }
+    child.config = tables.nextConfig[state.config][move];
+    const std::vector<unsigned short>& codes = stack.codes[depth];
+    std::vector<unsigned short>& childCodes = stack.codes[depth + 1];
+    for (size_t i = 0; i < tracked.size(); i++) {
+        childCodes[i] = tables.codeMoves[tables.size[tracked[i]]][codes[i]][move];
+    }
+}
+
+void Solver::countNodes(SearchStack& stack) {
+    unsigned long long total = nodes += stack.nodes;
+    stack.nodes = 0;
+    if (nodeLimit && total >= nodeLimit) stopped = true;
+    if (isCancelled()) stopped = true;
+}
+
+bool Solver::isCancelled() const {
+    return cancel != NULL && *cancel;
+}
+
+int Solver::search(SearchStack& stack, int depth, int cost, int bound, std::vector<SearchTask>* tasks) {
+    if (++stack.nodes == NODE_BATCH) countNodes(stack);
+    int h = heuristic(stack.codes[depth]);
+    if (cost + h > bound) return cost + h;
+    const PuzzleState& state = stack.states[depth];
+    if (h == 0 && state.isSolved()) return FOUND;
+    if (stopped) return INT_MAX;
+    if (tasks != NULL && depth == splitDepth) {
+        SearchTask task;
+        task.path = stack.path;
+        task.cost = cost;
+        tasks->push_back(task);
+        return INT_MAX;
+    }
+    // Reached as cheaply by another path, which searches everything below
+    int sequence = stack.sequences[depth];
+    if (bound - cost >= TRANSPOSITION_MIN_REMAINING && isTransposition(state, cost, sequence)) return INT_MAX;
+
+    int minimum = INT_MAX;
+    const std::vector<MoveCode>& next = automaton.getMoves(sequence);
+    for (size_t m = 0; m < next.size(); m++) {
+        MoveCode move = next[m];
+        playMove(stack, depth, move);
+        stack.path.push_back(move);
+        stack.sequences[depth + 1] = automaton.getNext(sequence, move);
+        int result = search(stack, depth + 1, cost + getMoveCost(state.config, move), bound, tasks);
+        if (result == FOUND) return FOUND;
+        stack.path.pop_back();
+        minimum = std::min(minimum, result);
+        if (stopped) break;
+    }
+    return minimum;
+}
+
+bool Solver::isTransposition(const PuzzleState& state, int cost, int sequence) {
+    unsigned long long hash = getHash(state);
+    std::atomic<unsigned long long>& entry = transpositions[hash & (((size_t)1 << TRANSPOSITION_BITS) - 1)];
+    unsigned long long key = hash >> TRANSPOSITION_KEY_SHIFT << TRANSPOSITION_KEY_SHIFT;
+    unsigned long long stamp = (unsigned long long)iteration << (2 * TRANSPOSITION_FIELD_BITS);
+    unsigned long long old = entry.load(std::memory_order_relaxed);
+    // The earlier visit only covers this one if it allowed every sequence
+    // of moves this one does
+    int oldCost = old & TRANSPOSITION_FIELD_MASK;
+    int oldSequence = (old >> TRANSPOSITION_FIELD_BITS) & TRANSPOSITION_FIELD_MASK;
+    if ((old >> (2 * TRANSPOSITION_FIELD_BITS)) == (key | stamp) >> (2 * TRANSPOSITION_FIELD_BITS) &&
+        oldCost <= cost && automaton.covers(oldSequence, sequence)) {
+        return true;
+    }
+    // Collisions just replace the older state
+    entry.store(key | stamp | (unsigned long long)sequence << TRANSPOSITION_FIELD_BITS | cost,
+                std::memory_order_relaxed);
+    return false;
+}
+
+int Solver::heuristic(const std::vector<unsigned short>& codes) const {
+    int h = 0;
+    const unsigned short *pieceCodes = codes.data();
+    for (size_t i = 0; i < databases.size(); i++) {
+        const PatternDatabase *database = databases[i];
+        h = std::max(h, database->getDistance(database->getIndex(pieceCodes)));
+        pieceCodes += database->getPieces().size();
+    }
+    return h;
+}
+
+int Solver::getDistance(const std::vector<unsigned short>& codes) const {
+    int distance = 0;
+    const unsigned short *pieceCodes = codes.data();
+    for (size_t i = 0; i < databases.size(); i++) {
+        const PatternDatabase *database = databases[i];
+        distance += database->getDistance(database->getIndex(pieceCodes));
+        pieceCodes += database->getPieces().size();
+    }
+    return distance;
+}
+
+void Solver::expandBeam(const std::vector<BeamNode>& beam, size_t begin, size_t end,
+                        std::vector<BeamChild>& children) const {
+    const SolverTables& tables = getTables();
+    std::vector<unsigned short> codes(tracked.size());
+    PuzzleState state;
+    for (size_t i = begin; i < end; i++) {
+        const BeamNode& node = beam[i];
+        const std::vector<MoveCode>& next = automaton.getMoves(node.sequence);
+        for (size_t m = 0; m < next.size(); m++) {
+            const unsigned char *perm = PuzzleState::getMovePermutation(next[m]);
+            for (int j = 0; j < NUM_STICKERS; j++) {
+                state.stickers[j] = node.state.stickers[perm[j]];
+            }
+            state.config = tables.nextConfig[node.state.config][next[m]];
+            for (size_t j = 0; j < tracked.size(); j++) {
+                codes[j] = tables.codeMoves[tables.size[tracked[j]]][node.codes[j]][next[m]];
+            }
+            BeamChild child = {getHash(state), getMisplaced(state) * BEAM_STICKER_WEIGHT + getDistance(codes),
+                               (unsigned int)i, next[m]};
+            children.push_back(child);
+        }
+    }
+}
+
+unsigned long long Solver::getHash(const PuzzleState& state) {
+    // FNV-1a over the stickers, eight at a time
+    unsigned long long hash = 14695981039346656037ULL ^ state.config;
+    for (int i = 0; i < NUM_STICKERS; i += 8) {
+        unsigned long long word;
+        std::memcpy(&word, &state.stickers[i], sizeof(word));
+        hash = (hash ^ word) * 1099511628211ULL;
+        hash ^= hash >> 29;
+    }
+    return hash ^ (hash >> 32);
+}
+
+bool Solver::playMacro(PuzzleState& state, bool turning, std::vector<MoveCode>& solution) {
+    const SolverTables& tables = getTables();
+    // Piece in each slot, and the slot holding each piece
+    std::array<int, NUM_SLOTS> pieces, slots;
+    std::array<bool, NUM_SLOTS> done;
+    for (int slot = 0; slot < NUM_SLOTS; slot++) {
+        pieces[slot] = tables.stickerSlot[state.stickers[tables.base[slot]]];
+        slots[pieces[slot]] = slot;
+        done[slot] = pieces[slot] == slot;
+        for (int i = 1; i < tables.size[slot] && turning; i++) {
+            if (state.stickers[tables.base[slot] + i] != tables.base[slot] + i) done[slot] = false;
+        }
+    }
+
+    int bestGain = 0;
+    std::vector<MoveCode> best, setup;
+    for (size_t m = 0; m < macros.size(); m++) {
+        const Macro& macro = macros[m];
+        int pieceSize = tables.size[macro.slots[0]];
+        if (turning ? !macro.twists : macro.slots.size() != 3) continue;
+        std::vector<int> orbit = PuzzleState::getOrbit(pieceSize);
+        std::vector<int> unsolved;
+        for (size_t i = 0; i < orbit.size(); i++) {
+            if (!done[orbit[i]]) unsolved.push_back(orbit[i]);
+        }
+        if (unsolved.empty()) continue;
+
+        // Slots the macro could be moved onto, all including the first
+        // unsolved slot. When placing, the piece that belongs there is one
+        // of the others.
+        std::vector<std::vector<int> > targets;
+        int first = unsolved[0];
+        if (!turning) {
+            for (size_t i = 0; i < orbit.size(); i++) {
+                int cycle[3] = {first, slots[first], orbit[i]};
+                if (cycle[2] == cycle[0] || cycle[2] == cycle[1]) continue;
+                std::sort(cycle, cycle + 3);
+                do {
+                    targets.push_back(std::vector<int>(cycle, cycle + 3));
+                } while (std::next_permutation(cycle, cycle + 3));
+            }
+        } else if (macro.slots.size() == 1) {
+            targets.push_back(std::vector<int>(1, first));
+        } else {
+            for (size_t i = 1; i < unsolved.size(); i++) {
+                if (macro.slots.size() == 2) {
+                    targets.push_back({first, unsolved[i]});
+                    continue;
+                }
+                for (size_t j = 1; j < unsolved.size(); j++) {
+                    if (j != i) targets.push_back({first, unsolved[i], unsolved[j]});
+                }
+            }
+        }
+
+        // Setups depend on how the pieces end up turned too when twisting
+        // one or two pieces, so try every turn of them
+        bool turns = turning && macro.slots.size() <= 2;
+        int numTurns = 1;
+        for (size_t i = 0; i < macro.slots.size() && turns; i++) {
+            numTurns *= factorial[pieceSize];
+        }
+        for (size_t t = 0; t < targets.size(); t++) {
+            for (int turn = 0; turn < numTurns; turn++) {
+                std::vector<int> codes;
+                for (size_t i = 0, rest = turn; i < macro.slots.size(); i++) {
+                    if (turns) {
+                        codes.push_back(tables.local[targets[t][i]] * factorial[pieceSize] + rest % factorial[pieceSize]);
+                        rest /= factorial[pieceSize];
+                    } else {
+                        codes.push_back(tables.local[targets[t][i]]);
+                    }
+                }
+                if (!findSetup(macro.slots, codes, turns, setup)) continue;
+                std::vector<MoveCode> sequence;
+                for (size_t i = setup.size(); i-- > 0;) {
+                    sequence.push_back(tables.inverse[setup[i]]);
+                }
+                sequence.insert(sequence.end(), macro.moves.begin(), macro.moves.end());
+                sequence.insert(sequence.end(), setup.begin(), setup.end());
+
+                // Only the target slots change, so follow just their stickers
+                int gain = 0;
+                for (size_t i = 0; i < targets[t].size() && gain > -NUM_SLOTS; i++) {
+                    int slot = targets[t][i];
+                    bool solved = true;
+                    for (int j = 0; j < (turning ? tables.size[slot] : 1) && solved; j++) {
+                        int position = tables.base[slot] + j;
+                        for (size_t k = sequence.size(); k-- > 0;) {
+                            position = PuzzleState::getMovePermutation(sequence[k])[position];
+                        }
+                        if (turning) {
+                            solved = state.stickers[position] == tables.base[slot] + j;
+                        } else {
+                            solved = tables.stickerSlot[state.stickers[position]] == slot;
+                        }
+                    }
+                    // Never break a solved piece
+                    if (done[slot] && !solved) gain = -NUM_SLOTS;
+                    gain += (int)solved - (int)done[slot];
+                }
+                if (gain > bestGain || (gain == bestGain && gain > 0 && sequence.size() < best.size())) {
+                    bestGain = gain;
+                    best = sequence;
+                }
+            }
+        }
+    }
+
+    for (size_t i = 0; i < best.size(); i++) {
+        state.applyMove(best[i]);
+    }
+    solution.insert(solution.end(), best.begin(), best.end());
+    return best.size() > 0;
+}
+
+bool Solver::findSetup(const std::vector<int>& slots, const std::vector<int>& targets, bool turning,
+                       std::vector<MoveCode>& setup) {
+    const SolverTables& tables = getTables();
+    int pieceSize = tables.size[slots[0]];
+    // Codes of a piece are its position, and its turn when turning
+    int divisor = turning ? 1 : factorial[pieceSize];
+    int numCodes = tables.codeMoves[pieceSize].size() / divisor;
+    std::vector<int> start;
+    for (size_t i = 0; i < slots.size(); i++) {
+        start.push_back(tables.local[slots[i]] * factorial[pieceSize] / divisor);
+    }
+    std::vector<int> codes(slots.size());
+
+    std::vector<unsigned char>& parents = (turning ? turnSetups : placeSetups)[slots];
+    if (parents.empty()) {
+        // Breadth first, storing the last move into each arrangement
+        size_t size = 1;
+        for (size_t i = 0; i < slots.size(); i++) {
+            size *= numCodes;
+        }
+        parents.assign(size, UNREACHED);
+        std::vector<unsigned int> queue(1, 0);
+        for (size_t i = 0; i < slots.size(); i++) {
+            queue[0] = queue[0] * numCodes + start[i];
+        }
+        parents[queue[0]] = MOVE_GYRO_OUTER;
+        for (size_t i = 0; i < queue.size(); i++) {
+            for (size_t j = slots.size(), index = queue[i]; j-- > 0; index /= numCodes) {
+                codes[j] = index % numCodes;
+            }
+            for (int move = 0; move < MOVE_GYRO_OUTER; move++) {
+                size_t next = 0;
+                for (size_t j = 0; j < slots.size(); j++) {
+                    next = next * numCodes + tables.codeMoves[pieceSize][codes[j] * divisor][move] / divisor;
+                }
+                if (parents[next] != UNREACHED) continue;
+                parents[next] = move;
+                queue.push_back(next);
+            }
+        }
+    }
+
+    size_t index = 0;
+    for (size_t i = 0; i < slots.size(); i++) {
+        index = index * numCodes + targets[i];
+    }
+    setup.clear();
+    if (parents[index] == UNREACHED) return false;
+    while (parents[index] != MOVE_GYRO_OUTER) {
+        MoveCode move = parents[index];
+        setup.push_back(move);
+        for (size_t j = slots.size(), rest = index; j-- > 0; rest /= numCodes) {
+            codes[j] = rest % numCodes;
+        }
+        index = 0;
+        for (size_t j = 0; j < slots.size(); j++) {
+            index = index * numCodes + tables.codeMoves[pieceSize][codes[j] * divisor][tables.inverse[move]] / divisor;
+        }
+    }
+    std::reverse(setup.begin(), setup.end());
+    return true;
+}
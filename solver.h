@@ -0,0 +1,253 @@
+/**************************************************************************
+ * 3to4++ - https://github.com/rayzchen/3to4++
+ *-------------------------------------------------------------------------
+ * Copyright 2024 Ray Chen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ **************************************************************************/
+
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <vector>
+#include <map>
+#include <string>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include "state.h"
+
+// Cost of each kind of move. Turns and gyros also pay sliceGyro for every
+// slice gyro played to set them up. Rotations are left out of the search
+// when rotate is 0.
+struct SolverMetric {
+    int turn;
+    int gyro;
+    int sliceGyro;
+    int rotate;
+
+    // Cell turns and gyros, like scramble lengths
+    static SolverMetric turnMetric();
+    // Every move the controller animates
+    static SolverMetric physicalMetric();
+};
+
+// Exact distances from a set of goal states, looking only at where a few
+// pieces are and how they are turned. Every move costs at least as much
+// in the full puzzle, so the distances never overestimate. Distances are
+// packed two to a byte, and anything from 15 up is stored as 15.
+class PatternDatabase {
+    public:
+        PatternDatabase(const std::vector<int>& pieces, const std::vector<PuzzleState>& goals, const SolverMetric& metric);
+        ~PatternDatabase();
+        PatternDatabase(const PatternDatabase&) = delete;
+        PatternDatabase& operator=(const PatternDatabase&) = delete;
+        const std::vector<int>& getPieces() const;
+        size_t getSize() const;
+        int getMaxDistance() const;
+        // Codes of the tracked pieces, in getPieces() order
+        size_t getIndex(const unsigned short* codes) const;
+        int getDistance(size_t index) const { return (table[index / 2] >> (index % 2 * 4)) & 15; }
+
+        // Writes the table in the format load maps
+        bool save(const std::string& filename) const;
+        // Maps a saved table read-only, so processes share it through the
+        // page cache. NULL if the file is missing, corrupt, from another
+        // puzzle core version or for other pieces, goals or metric.
+        static PatternDatabase* load(const std::string& filename, const std::vector<int>& pieces,
+                                     const std::vector<PuzzleState>& goals, const SolverMetric& metric);
+        bool isMapped() const;
+        // File name for a table, unique per pieces and metric
+        static std::string getFileName(const std::vector<int>& pieces, const SolverMetric& metric);
+
+        // Position and turn of the piece whose home is the given slot
+        static unsigned short getPieceCode(const PuzzleState& state, int piece);
+        static unsigned short movePieceCode(int piece, unsigned short code, MoveCode move);
+        static int getNumPieceCodes(int piece);
+
+    private:
+        std::vector<int> pieces;
+        std::vector<size_t> placeValues;
+        SolverMetric metric;
+        size_t numGoals;
+        size_t size;
+        int maxDistance;
+        // Packed distances, in packed or in a mapped file
+        const unsigned char *table;
+        std::vector<unsigned char> packed;
+        void *mapping;
+        size_t mappingSize;
+
+        PatternDatabase(const std::vector<int>& pieces);
+};
+
+// IDA* over the cell turns and gyros, with pattern databases as the
+// heuristic. Each move is played with the slice gyros the controller would
+// use to set it up.
+class Solver {
+    public:
+        // With a database directory the solver uses bigger tables, mapping
+        // the ones saved there and building any that are missing
+        Solver(SolverMetric metric = SolverMetric::turnMetric(), const std::string& databaseDirectory = "");
+        ~Solver();
+        // Shortest solution in the metric, false if none was found within
+        // maxNodes search nodes (0 for no limit)
+        bool solveOptimal(const PuzzleState& state, std::vector<MoveCode>& solution, unsigned long long maxNodes = 0);
+        // Tries a short optimal search, then places every piece with 3-cycles
+        // and turns them home with twists. Always finishes, but solutions run
+        // to a couple of thousand moves.
+        bool solveStaged(const PuzzleState& state, std::vector<MoveCode>& solution);
+        // Keeps the states with the fewest misplaced stickers at each depth,
+        // then finishes the closest one found with solveStaged. Takes under
+        // a second, but a 45 move scramble still takes about 2000 moves, as
+        // misplaced stickers stop telling states apart within a few moves.
+        bool solveBeam(const PuzzleState& state, std::vector<MoveCode>& solution);
+        // Turns and gyros from solved to state: gyros to the orientation a
+        // staged solution of state ends in, then that solution backwards.
+        // As long as staged solutions, but gives any state a scramble.
+        bool getScramble(const PuzzleState& state, std::vector<MoveCode>& scramble);
+        unsigned long long getNodes() const;
+        // Cost bound of the current IDA* iteration
+        int getBound() const;
+        // Threads for optimal searches, 0 for one per core
+        void setThreads(unsigned int threads);
+        // Searches give up soon after the flag is set, from any thread
+        void setCancelFlag(const std::atomic<bool>* cancel);
+        // States kept at each depth of a beam search, and the bytes it may
+        // use, which can make the beam narrower
+        void setBeamWidth(size_t width);
+        void setBeamMemory(size_t bytes);
+        // Saves the tables that were not mapped from the directory, false
+        // if one could not be written
+        bool saveDatabases(const std::string& directory) const;
+        int getCost(const PuzzleState& state, const std::vector<MoveCode>& solution) const;
+
+        // Cancels moves undone or repeated by later ones, looking past moves
+        // they commute with, and cuts the moves off once state is solved.
+        // Slice gyros are dropped, as playing the rest sets them up again.
+        static void simplify(const PuzzleState& state, std::vector<MoveCode>& solution);
+        // Moves to schedule for a solution, slice gyros included
+        static std::vector<MoveEntry> getMoveEntries(const PuzzleState& state, const std::vector<MoveCode>& solution);
+        // Turns and gyros, and rotations when the metric charges for them
+        static std::vector<MoveCode> getSearchMoves(const SolverMetric& metric);
+        // The solved puzzle in every orientation
+        static const std::vector<PuzzleState>& getSolvedStates();
+
+    private:
+        // Commutator moving only the pieces in slots
+        struct Macro {
+            std::vector<MoveCode> moves;
+            std::vector<int> slots;
+            // Turns some piece without moving it
+            bool twists;
+        };
+
+        // Stacks of one search thread
+        struct SearchStack {
+            std::vector<PuzzleState> states;
+            std::vector<std::vector<unsigned short> > codes;
+            std::vector<MoveCode> path;
+            // Automaton state after the moves to each depth
+            std::vector<int> sequences;
+            // Nodes not yet added to the shared count
+            unsigned long long nodes;
+        };
+        // Subtree a few moves from the start, searched by one thread
+        struct SearchTask {
+            std::vector<MoveCode> path;
+            int cost;
+        };
+        // Tasks of one thread. It takes from the back and idle threads
+        // steal from the front.
+        struct TaskQueue {
+            std::mutex mutex;
+            std::vector<SearchTask> tasks;
+            size_t front;
+        };
+        // State kept in the beam, with the codes of the tracked pieces
+        struct BeamNode {
+            PuzzleState state;
+            std::vector<unsigned short> codes;
+            int sequence;
+        };
+        // Move from a node of the last depth, before the child is built
+        struct BeamChild {
+            unsigned long long hash;
+            int distance;
+            unsigned int parent;
+            MoveCode move;
+        };
+
+        SolverMetric metric;
+        std::vector<MoveCode> moves;
+        // Keeps the search to canonical sequences of moves
+        MoveAutomaton automaton;
+        // Goals in every orientation, for the optimal solver
+        std::vector<PatternDatabase*> databases;
+        unsigned int threads;
+        std::atomic<unsigned long long> nodes;
+        unsigned long long nodeLimit;
+        std::atomic<int> currentBound;
+        const std::atomic<bool> *cancel;
+        // Set once a solution is found, the nodes run out or the search
+        // is cancelled
+        std::atomic<bool> stopped;
+        std::mutex solutionMutex;
+        bool found;
+        std::vector<MoveCode> foundPath;
+        // Depth at which the tree is split into tasks
+        int splitDepth;
+        // States already searched this iteration, shared by every thread
+        // without locks. Each entry packs the high bits of the state hash
+        // with the iteration, and the cost and automaton state the state
+        // was reached at.
+        std::unique_ptr<std::atomic<unsigned long long>[]> transpositions;
+        unsigned int iteration;
+        size_t beamWidth;
+        size_t beamMemory;
+        // Pieces of the databases, in order
+        std::vector<int> tracked;
+        std::vector<Macro> macros;
+        // Last move of the shortest setup taking the pieces of some slots
+        // anywhere, by the slots, with or without their turns
+        std::map<std::vector<int>, std::vector<unsigned char> > placeSetups;
+        std::map<std::vector<int>, std::vector<unsigned char> > turnSetups;
+
+        // Pieces of each table: pairs, or triples when they come from disk
+        static std::vector<std::vector<int> > getDatabasePieces(bool large);
+        int getMoveCost(int config, MoveCode move) const;
+        bool runSearch(const PuzzleState& state, std::vector<MoveCode>& solution);
+        void runTasks(const PuzzleState& state, int bound, std::vector<TaskQueue>& queues, size_t queue,
+                      std::atomic<int>& minimum);
+        bool takeTask(std::vector<TaskQueue>& queues, size_t queue, SearchTask& task);
+        void startStack(SearchStack& stack, const PuzzleState& state, int bound) const;
+        void playMove(SearchStack& stack, int depth, MoveCode move) const;
+        void countNodes(SearchStack& stack);
+        bool isCancelled() const;
+        // Hands the subtrees at splitDepth to tasks instead when it is set
+        int search(SearchStack& stack, int depth, int cost, int bound, std::vector<SearchTask>* tasks);
+        bool isTransposition(const PuzzleState& state, int cost, int sequence);
+        int heuristic(const std::vector<unsigned short>& codes) const;
+        // Sum of the database distances, which tells apart states far from
+        // solved better but can overestimate
+        int getDistance(const std::vector<unsigned short>& codes) const;
+        void expandBeam(const std::vector<BeamNode>& beam, size_t begin, size_t end,
+                        std::vector<BeamChild>& children) const;
+        static unsigned long long getHash(const PuzzleState& state);
+        bool playMacro(PuzzleState& state, bool turning, std::vector<MoveCode>& solution);
+        bool findSetup(const std::vector<int>& slots, const std::vector<int>& targets, bool turning,
+                       std::vector<MoveCode>& setup);
+};
+
+#endif // solver.h
@@ -0,0 +1,765 @@
+/**************************************************************************
+ * 3to4++ - https://github.com/rayzchen/3to4++
+ *-------------------------------------------------------------------------
+ * Copyright 2024 Ray Chen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ **************************************************************************/
+
+#include "state.h"
+#include <algorithm>
+#include <map>
+
+static const char *codeAlphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+struct StateTables {
+    std::array<unsigned char, NUM_SLOTS + 1> slotSticker;
+    std::array<unsigned char, NUM_STICKERS> stickerSlot;
+    std::array<Color, NUM_STICKERS> colors;
+    std::map<std::array<int, 4>, int> slotByColors;
+    std::array<MoveEntry, NUM_MOVES> moves;
+    std::array<std::array<unsigned char, NUM_STICKERS>, NUM_MOVES> perms;
+    // Positions whose sticker each move changes
+    std::array<std::vector<unsigned char>, NUM_MOVES> movedStickers;
+    std::array<std::array<unsigned char, NUM_MOVES>, NUM_CONFIGS> nextConfig;
+    // Codes played for each turn and gyro, slice gyros first
+    std::array<std::array<std::vector<MoveCode>, MOVE_GYRO_OUTER>, NUM_CONFIGS> expansions;
+    // The same as entries for every code, and the config after them
+    std::array<std::array<std::vector<MoveEntry>, NUM_MOVES>, NUM_CONFIGS> macros;
+    std::array<std::array<unsigned char, NUM_MOVES>, NUM_CONFIGS> macroConfigs;
+    // Codes playable without slice gyros first, one bit each
+    std::array<unsigned long long, NUM_CONFIGS> legalMoves;
+    std::array<std::vector<int>, 5> orbits;
+    // Radix of each digit in an encoded state
+    std::vector<int> radices;
+    unsigned char solvedConfig;
+
+    StateTables();
+};
+
+static MoveCode findMove(const std::array<MoveEntry, NUM_MOVES>& moves, MoveEntry entry) {
+    for (int i = 0; i < NUM_MOVES; i++) {
+        const MoveEntry& move = moves[i];
+        if (move.type != entry.type) continue;
+        switch (entry.type) {
+            case TURN:
+                if (move.cell == entry.cell && move.direction == entry.direction) return i;
+                break;
+            case GYRO:
+                if (move.cell == entry.cell) return i;
+                break;
+            case GYRO_OUTER:
+                return i;
+            case GYRO_MIDDLE:
+                if (move.location == entry.location) return i;
+                break;
+            case ROTATE:
+                if (move.direction == entry.direction) return i;
+                break;
+        }
+    }
+    return NUM_MOVES;
+}
+
+static const StateTables& getTables() {
+    static StateTables tables;
+    return tables;
+}
+
+StateTables::StateTables() {
+    Puzzle puzzle;
+    std::array<Piece*, NUM_SLOTS> slots = PuzzleState::getSlots(puzzle);
+    int sticker = 0;
+    for (int i = 0; i < NUM_SLOTS; i++) {
+        slotSticker[i] = sticker;
+        std::array<int, 4> key = {UNUSED, UNUSED, UNUSED, UNUSED};
+        for (int j = 0; j < 4; j++) {
+            Color color = PuzzleState::getSticker(*slots[i], j);
+            if (color == UNUSED) break;
+            colors[sticker] = color;
+            stickerSlot[sticker] = i;
+            key[j] = color;
+            sticker++;
+        }
+        // Every piece has a different set of colors
+        std::sort(key.begin(), key.end());
+        slotByColors[key] = i;
+        orbits[sticker - slotSticker[i]].push_back(i);
+    }
+    slotSticker[NUM_SLOTS] = sticker;
+    solvedConfig = PuzzleState::getConfig(puzzle);
+
+    int index = 0;
+    MoveEntry entry;
+    entry.type = TURN;
+    for (int cell = 0; cell < 8; cell++) {
+        for (int direction = 0; direction < 6; direction++) {
+            if (puzzle.canRotateCell((CellLocation)cell, (RotateDirection)direction)) {
+                entry.cell = (CellLocation)cell;
+                entry.direction = (RotateDirection)direction;
+                entry.animLength = (cell >= UP) ? 2.0f : 1.0f;
+                moves[index++] = entry;
+            }
+        }
+    }
+    entry.type = GYRO;
+    for (int cell = RIGHT; cell <= BACK; cell++) {
+        entry.cell = (CellLocation)cell;
+        entry.animLength = (cell == RIGHT || cell == LEFT) ? 4.0f : 3.0f;
+        moves[index++] = entry;
+    }
+    entry.type = GYRO_OUTER;
+    entry.animLength = 2.0f;
+    entry.location = 1;
+    moves[index++] = entry;
+    entry.type = GYRO_MIDDLE;
+    entry.animLength = 1.0f;
+    for (int location = -1; location <= 1; location++) {
+        entry.location = location;
+        moves[index++] = entry;
+    }
+    entry.type = ROTATE;
+    entry.direction = ZY;
+    moves[index++] = entry;
+    entry.direction = YZ;
+    moves[index++] = entry;
+
+    for (int move = 0; move < NUM_MOVES; move++) {
+        // Label every sticker with its own position and see where they end up
+        Puzzle labelled;
+        slots = PuzzleState::getSlots(labelled);
+        for (int i = 0; i < NUM_STICKERS; i++) {
+            int slot = stickerSlot[i];
+            PuzzleState::getSticker(*slots[slot], i - slotSticker[slot]) = (Color)i;
+        }
+        labelled.applyMove(moves[move]);
+        for (int i = 0; i < NUM_STICKERS; i++) {
+            int slot = stickerSlot[i];
+            perms[move][i] = PuzzleState::getSticker(*slots[slot], i - slotSticker[slot]);
+            if (perms[move][i] != i) movedStickers[move].push_back(i);
+        }
+    }
+
+    for (int config = 0; config < NUM_CONFIGS; config++) {
+        for (int move = 0; move < NUM_MOVES; move++) {
+            PuzzleState::setConfig(puzzle, config);
+            entry = moves[move];
+            if (entry.type == GYRO_MIDDLE && entry.location != 0 && !puzzle.canGyroMiddle(entry.location)) {
+                nextConfig[config][move] = config;
+                continue;
+            }
+            puzzle.applyMove(entry);
+            nextConfig[config][move] = PuzzleState::getConfig(puzzle);
+        }
+    }
+
+    std::vector<MoveEntry> expanded;
+    for (int config = 0; config < NUM_CONFIGS; config++) {
+        PuzzleState::setConfig(puzzle, config);
+        for (int move = 0; move < MOVE_GYRO_OUTER; move++) {
+            expanded.clear();
+            if (moves[move].type == GYRO) {
+                puzzle.expandGyro(moves[move].cell, expanded);
+            } else {
+                puzzle.expandCellMove(moves[move].cell, moves[move].direction, expanded);
+            }
+            for (size_t i = 0; i < expanded.size(); i++) {
+                expansions[config][move].push_back(findMove(moves, expanded[i]));
+            }
+            macros[config][move] = expanded;
+        }
+        for (int move = MOVE_GYRO_OUTER; move < NUM_MOVES; move++) {
+            entry = moves[move];
+            if (entry.type == GYRO_OUTER) entry.location = (config < 8) ? -1 : 1;
+            macros[config][move].push_back(entry);
+        }
+
+        legalMoves[config] = 0;
+        for (int move = 0; move < NUM_MOVES; move++) {
+            const std::vector<MoveEntry>& macro = macros[config][move];
+            int next = config;
+            for (size_t i = 0; i < macro.size(); i++) {
+                next = nextConfig[next][findMove(moves, macro[i])];
+            }
+            macroConfigs[config][move] = next;
+            entry = moves[move];
+            bool legal = macro.size() == 1;
+            if (entry.type == GYRO_MIDDLE && entry.location != 0) legal = puzzle.canGyroMiddle(entry.location);
+            if (legal) legalMoves[config] |= 1ULL << move;
+        }
+    }
+
+    for (int size = 1; size <= 4; size++) {
+        for (size_t i = 0; i + 1 < orbits[size].size(); i++) {
+            radices.push_back(orbits[size].size() - i);
+        }
+    }
+    for (int i = 0; i < NUM_SLOTS; i++) {
+        int size = slotSticker[i + 1] - slotSticker[i];
+        if (size > 1) radices.push_back(size == 2 ? 2 : (size == 3 ? 6 : 24));
+    }
+    radices.push_back(NUM_CONFIGS);
+}
+
+PuzzleState::PuzzleState() {
+    for (int i = 0; i < NUM_STICKERS; i++) {
+        stickers[i] = i;
+    }
+    config = getTables().solvedConfig;
+}
+
+PuzzleState::PuzzleState(const Puzzle& puzzle) {
+    const StateTables& tables = getTables();
+    Puzzle copy = puzzle;
+    std::array<Piece*, NUM_SLOTS> slots = getSlots(copy);
+    for (int i = 0; i < NUM_SLOTS; i++) {
+        int size = getSlotSize(i);
+        std::array<int, 4> key = {UNUSED, UNUSED, UNUSED, UNUSED};
+        for (int j = 0; j < size; j++) {
+            key[j] = getSticker(*slots[i], j);
+        }
+        std::sort(key.begin(), key.end());
+        int home = tables.slotByColors.at(key);
+        for (int j = 0; j < size; j++) {
+            Color color = getSticker(*slots[i], j);
+            for (int k = 0; k < size; k++) {
+                if (tables.colors[tables.slotSticker[home] + k] == color) {
+                    stickers[tables.slotSticker[i] + j] = tables.slotSticker[home] + k;
+                }
+            }
+        }
+    }
+    config = getConfig(puzzle);
+}
+
+void PuzzleState::toPuzzle(Puzzle& puzzle) const {
+    const StateTables& tables = getTables();
+    std::array<Piece*, NUM_SLOTS> slots = getSlots(puzzle);
+    for (int i = 0; i < NUM_STICKERS; i++) {
+        int slot = tables.stickerSlot[i];
+        getSticker(*slots[slot], i - tables.slotSticker[slot]) = tables.colors[stickers[i]];
+    }
+    setConfig(puzzle, config);
+}
+
+void PuzzleState::applyMove(MoveCode move) {
+    const StateTables& tables = getTables();
+    const unsigned char *perm = tables.perms[move].data();
+    std::array<unsigned char, NUM_STICKERS> old = stickers;
+    for (int i = 0; i < NUM_STICKERS; i++) {
+        stickers[i] = old[perm[i]];
+    }
+    config = tables.nextConfig[config][move];
+}
+
+bool PuzzleState::isSolved() const {
+    // Solved in any orientation: every cell shows a single color
+    const StateTables& tables = getTables();
+    std::array<int, 8> cellColors;
+    cellColors.fill(UNUSED);
+    for (int i = 0; i < NUM_STICKERS; i++) {
+        int cell = tables.colors[i];
+        Color color = tables.colors[stickers[i]];
+        if (cellColors[cell] == UNUSED) {
+            cellColors[cell] = color;
+        } else if (cellColors[cell] != color) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PuzzleState::operator==(const PuzzleState& other) const {
+    return config == other.config && stickers == other.stickers;
+}
+
+bool PuzzleState::operator!=(const PuzzleState& other) const {
+    return !(*this == other);
+}
+
+std::array<unsigned char, NUM_SLOTS> PuzzleState::getPieces() const {
+    const StateTables& tables = getTables();
+    std::array<unsigned char, NUM_SLOTS> pieces;
+    for (int i = 0; i < NUM_SLOTS; i++) {
+        pieces[i] = tables.stickerSlot[stickers[tables.slotSticker[i]]];
+    }
+    return pieces;
+}
+
+std::array<unsigned char, NUM_SLOTS> PuzzleState::getTwists() const {
+    const StateTables& tables = getTables();
+    std::array<unsigned char, NUM_SLOTS> twists;
+    for (int i = 0; i < NUM_SLOTS; i++) {
+        int first = tables.slotSticker[i];
+        int size = getSlotSize(i);
+        int home = tables.slotSticker[tables.stickerSlot[stickers[first]]];
+        unsigned char perm[4];
+        for (int j = 0; j < size; j++) {
+            perm[j] = stickers[first + j] - home;
+        }
+        twists[i] = rankPermutation(perm, size);
+    }
+    return twists;
+}
+
+bool PuzzleState::setPieces(const std::array<unsigned char, NUM_SLOTS>& pieces,
+                            const std::array<unsigned char, NUM_SLOTS>& twists) {
+    const StateTables& tables = getTables();
+    static const int factorial[] = {1, 1, 2, 6, 24};
+    std::array<bool, NUM_SLOTS> used;
+    used.fill(false);
+    for (int i = 0; i < NUM_SLOTS; i++) {
+        if (pieces[i] >= NUM_SLOTS || used[pieces[i]]) return false;
+        if (getSlotSize(pieces[i]) != getSlotSize(i)) return false;
+        if (twists[i] >= factorial[getSlotSize(i)]) return false;
+        used[pieces[i]] = true;
+    }
+    for (int i = 0; i < NUM_SLOTS; i++) {
+        int size = getSlotSize(i);
+        unsigned char perm[4];
+        unrankPermutation(twists[i], perm, size);
+        for (int j = 0; j < size; j++) {
+            stickers[tables.slotSticker[i] + j] = tables.slotSticker[pieces[i]] + perm[j];
+        }
+    }
+    return true;
+}
+
+// Little endian base 2^32 number
+static void multiplyAdd(std::vector<unsigned int>& number, unsigned int factor, unsigned int addend) {
+    unsigned long long carry = addend;
+    for (size_t i = 0; i < number.size(); i++) {
+        carry += (unsigned long long)number[i] * factor;
+        number[i] = (unsigned int)carry;
+        carry >>= 32;
+    }
+    if (carry) number.push_back((unsigned int)carry);
+}
+
+static unsigned int divideRemainder(std::vector<unsigned int>& number, unsigned int divisor) {
+    unsigned long long remainder = 0;
+    for (size_t i = number.size(); i-- > 0;) {
+        remainder = (remainder << 32) | number[i];
+        number[i] = (unsigned int)(remainder / divisor);
+        remainder %= divisor;
+    }
+    while (number.size() && number.back() == 0) number.pop_back();
+    return (unsigned int)remainder;
+}
+
+std::string PuzzleState::encode() const {
+    const StateTables& tables = getTables();
+    std::array<unsigned char, NUM_SLOTS> pieces = getPieces();
+    std::array<unsigned char, NUM_SLOTS> twists = getTwists();
+    std::vector<int> digits;
+    for (int size = 1; size <= 4; size++) {
+        const std::vector<int>& orbit = tables.orbits[size];
+        for (size_t i = 0; i + 1 < orbit.size(); i++) {
+            int smaller = 0;
+            for (size_t j = i + 1; j < orbit.size(); j++) {
+                if (pieces[orbit[j]] < pieces[orbit[i]]) smaller++;
+            }
+            digits.push_back(smaller);
+        }
+    }
+    for (int i = 0; i < NUM_SLOTS; i++) {
+        if (getSlotSize(i) > 1) digits.push_back(twists[i]);
+    }
+    digits.push_back(config);
+
+    std::vector<unsigned int> number;
+    for (size_t i = 0; i < digits.size(); i++) {
+        multiplyAdd(number, tables.radices[i], digits[i]);
+    }
+    std::string code;
+    do {
+        code += codeAlphabet[divideRemainder(number, 64)];
+    } while (number.size());
+    std::reverse(code.begin(), code.end());
+    return code;
+}
+
+bool PuzzleState::decode(std::string code) {
+    const StateTables& tables = getTables();
+    std::string alphabet(codeAlphabet);
+    std::vector<unsigned int> number;
+    for (size_t i = 0; i < code.size(); i++) {
+        size_t value = alphabet.find(code[i]);
+        if (value == std::string::npos) return false;
+        multiplyAdd(number, 64, value);
+    }
+    std::vector<int> digits(tables.radices.size());
+    for (size_t i = digits.size(); i-- > 0;) {
+        digits[i] = divideRemainder(number, tables.radices[i]);
+    }
+    if (number.size()) return false;
+
+    std::array<unsigned char, NUM_SLOTS> pieces, twists;
+    size_t index = 0;
+    for (int size = 1; size <= 4; size++) {
+        const std::vector<int>& orbit = tables.orbits[size];
+        std::vector<int> remaining(orbit);
+        for (size_t i = 0; i < orbit.size(); i++) {
+            int digit = (i + 1 < orbit.size()) ? digits[index++] : 0;
+            pieces[orbit[i]] = remaining[digit];
+            remaining.erase(remaining.begin() + digit);
+        }
+    }
+    for (int i = 0; i < NUM_SLOTS; i++) {
+        twists[i] = (getSlotSize(i) > 1) ? digits[index++] : 0;
+    }
+    if (!setPieces(pieces, twists)) return false;
+    config = digits[index];
+    return true;
+}
+
+MoveEntry PuzzleState::getMoveEntry(MoveCode move) const {
+    MoveEntry entry = getTables().moves[move];
+    if (entry.type == GYRO_OUTER) {
+        entry.location = (config < 8) ? -1 : 1;
+    }
+    return entry;
+}
+
+MoveCode PuzzleState::getMoveCode(MoveEntry entry) {
+    return findMove(getTables().moves, entry);
+}
+
+const std::vector<MoveCode>& PuzzleState::expandMove(MoveCode move) const {
+    return getTables().expansions[config][move];
+}
+
+const unsigned char* PuzzleState::getMovePermutation(MoveCode move) {
+    return getTables().perms[move].data();
+}
+
+unsigned long long PuzzleState::getLegalMoves(int config) {
+    return getTables().legalMoves[config];
+}
+
+const std::vector<MoveEntry>& PuzzleState::getMacro(int config, MoveCode move) {
+    return getTables().macros[config][move];
+}
+
+int PuzzleState::getNextConfig(int config, MoveCode move) {
+    return getTables().macroConfigs[config][move];
+}
+
+int PuzzleState::getSlotSize(int slot) {
+    const StateTables& tables = getTables();
+    return tables.slotSticker[slot + 1] - tables.slotSticker[slot];
+}
+
+int PuzzleState::getSlotSticker(int slot) {
+    return getTables().slotSticker[slot];
+}
+
+Color PuzzleState::getStickerColor(int sticker) {
+    return getTables().colors[sticker];
+}
+
+std::vector<int> PuzzleState::getOrbit(int size) {
+    return getTables().orbits[size];
+}
+
+unsigned long long PuzzleState::rankPermutation(const unsigned char* perm, int n) {
+    unsigned long long rank = 0;
+    for (int i = 0; i < n; i++) {
+        int smaller = 0;
+        for (int j = i + 1; j < n; j++) {
+            if (perm[j] < perm[i]) smaller++;
+        }
+        rank = rank * (n - i) + smaller;
+    }
+    return rank;
+}
+
+void PuzzleState::unrankPermutation(unsigned long long rank, unsigned char* perm, int n) {
+    unsigned char digits[20];
+    for (int i = n - 1; i >= 0; i--) {
+        digits[i] = rank % (n - i);
+        rank /= (n - i);
+    }
+    unsigned char remaining[20];
+    for (int i = 0; i < n; i++) {
+        remaining[i] = i;
+    }
+    for (int i = 0; i < n; i++) {
+        perm[i] = remaining[digits[i]];
+        for (int j = digits[i]; j < n - i - 1; j++) {
+            remaining[j] = remaining[j + 1];
+        }
+    }
+}
+
+std::array<Piece*, NUM_SLOTS> PuzzleState::getSlots(Puzzle& puzzle) {
+    std::array<Piece*, NUM_SLOTS> slots;
+    int index = 0;
+    for (int x = 0; x < 3; x++) {
+        for (int y = 0; y < 3; y++) {
+            for (int z = 0; z < 3; z++) {
+                slots[index++] = &puzzle.leftCell[x][y][z];
+            }
+        }
+    }
+    for (int x = 0; x < 3; x++) {
+        for (int y = 0; y < 3; y++) {
+            for (int z = 0; z < 3; z++) {
+                slots[index++] = &puzzle.rightCell[x][y][z];
+            }
+        }
+    }
+    for (int y = 0; y < 3; y++) {
+        for (int z = 0; z < 3; z++) {
+            slots[index++] = &puzzle.innerSlice[y][z];
+        }
+    }
+    for (int y = 0; y < 3; y++) {
+        for (int z = 0; z < 3; z++) {
+            slots[index++] = &puzzle.outerSlice[y][z];
+        }
+    }
+    slots[index++] = &puzzle.topCell;
+    slots[index++] = &puzzle.bottomCell;
+    for (int i = 0; i < 3; i++) {
+        slots[index++] = &puzzle.frontCell[i];
+    }
+    for (int i = 0; i < 3; i++) {
+        slots[index++] = &puzzle.backCell[i];
+    }
+    return slots;
+}
+
+Color& PuzzleState::getSticker(Piece& piece, int index) {
+    switch (index) {
+        case 0: return piece.a;
+        case 1: return piece.b;
+        case 2: return piece.c;
+        default: return piece.d;
+    }
+}
+
+int PuzzleState::getConfig(const Puzzle& puzzle) {
+    int outer = (puzzle.outerSlicePos == 1) ? 0 : 1;
+    int middle = puzzle.middleSlicePos + 1 + outer;
+    return outer * 8 + middle * 2 + ((puzzle.middleSliceDir == FRONT) ? 1 : 0);
+}
+
+void PuzzleState::setConfig(Puzzle& puzzle, int config) {
+    int outer = config / 8;
+    puzzle.outerSlicePos = (outer == 0) ? 1 : -1;
+    puzzle.middleSlicePos = config % 8 / 2 - 1 - outer;
+    puzzle.middleSliceDir = (config % 2) ? FRONT : UP;
+}
+
+// What a sequence of moves does from every config, and how many turns,
+// gyros, slice gyros and rotations it plays from each
+struct MoveAction {
+    std::array<unsigned char, NUM_STICKERS> stickers;
+    std::array<unsigned char, NUM_CONFIGS> configs;
+    std::array<std::array<unsigned char, 4>, NUM_CONFIGS> counts;
+
+    MoveAction();
+    void play(MoveCode move);
+    bool operator==(const MoveAction& other) const;
+    // Plays no more of any kind of move than other, from every config
+    bool isNoCostlier(const MoveAction& other) const;
+};
+
+MoveAction::MoveAction() {
+    for (int i = 0; i < NUM_STICKERS; i++) {
+        stickers[i] = i;
+    }
+    for (int config = 0; config < NUM_CONFIGS; config++) {
+        configs[config] = config;
+        counts[config].fill(0);
+    }
+}
+
+void MoveAction::play(MoveCode move) {
+    const StateTables& tables = getTables();
+    const unsigned char *perm = tables.perms[move].data();
+    std::array<unsigned char, NUM_STICKERS> old = stickers;
+    for (int i = 0; i < NUM_STICKERS; i++) {
+        stickers[i] = old[perm[i]];
+    }
+    int kind = (move < MOVE_GYRO) ? 0 : (move < MOVE_GYRO_OUTER) ? 1 : (move < MOVE_ROTATE) ? 2 : 3;
+    for (int config = 0; config < NUM_CONFIGS; config++) {
+        counts[config][kind]++;
+        counts[config][2] += tables.macros[configs[config]][move].size() - 1;
+        configs[config] = tables.macroConfigs[configs[config]][move];
+    }
+}
+
+bool MoveAction::operator==(const MoveAction& other) const {
+    return stickers == other.stickers && configs == other.configs;
+}
+
+bool MoveAction::isNoCostlier(const MoveAction& other) const {
+    for (int config = 0; config < NUM_CONFIGS; config++) {
+        for (int kind = 0; kind < 4; kind++) {
+            if (counts[config][kind] > other.counts[config][kind]) return false;
+        }
+    }
+    return true;
+}
+
+MoveAutomaton::MoveAutomaton(const std::vector<MoveCode>& moves) {
+    MoveAction none;
+    std::vector<MoveCode> played;
+    std::vector<MoveAction> actions;
+    for (size_t i = 0; i < moves.size(); i++) {
+        MoveAction action;
+        action.play(moves[i]);
+        bool repeated = action == none;
+        for (size_t j = 0; j < actions.size() && !repeated; j++) {
+            repeated = actions[j] == action && actions[j].isNoCostlier(action);
+        }
+        if (repeated) continue;
+        played.push_back(moves[i]);
+        actions.push_back(action);
+    }
+
+    // Number of times in a row each move is worth playing. Powers always
+    // come back to an earlier one, which plays fewer moves.
+    std::vector<int> runs(played.size());
+    for (size_t i = 0; i < played.size(); i++) {
+        std::vector<MoveAction> powers(1, none);
+        MoveAction power;
+        bool shorter = false;
+        while (!shorter) {
+            power.play(played[i]);
+            for (size_t j = 0; j < powers.size() && !shorter; j++) {
+                shorter = powers[j] == power && powers[j].isNoCostlier(power);
+            }
+            for (size_t j = 0; j < actions.size() && powers.size() > 1 && !shorter; j++) {
+                shorter = actions[j] == power && actions[j].isNoCostlier(power);
+            }
+            if (!shorter) powers.push_back(power);
+        }
+        runs[i] = powers.size() - 1;
+    }
+
+    // State 0 is the start, then one state per move and run length
+    std::vector<int> firstState(played.size());
+    int numStates = 1;
+    for (size_t i = 0; i < played.size(); i++) {
+        firstState[i] = numStates;
+        numStates += runs[i];
+    }
+    std::array<short, NUM_MOVES> unreachable;
+    unreachable.fill(-1);
+    next.assign(numStates, unreachable);
+    for (size_t j = 0; j < played.size(); j++) {
+        next[0][played[j]] = firstState[j];
+    }
+    for (size_t i = 0; i < played.size(); i++) {
+        for (size_t j = 0; j < played.size(); j++) {
+            if (i == j) {
+                for (int run = 1; run < runs[i]; run++) {
+                    next[firstState[i] + run - 1][played[j]] = firstState[i] + run;
+                }
+                continue;
+            }
+            MoveAction pair = actions[i];
+            pair.play(played[j]);
+            bool allowed = !(pair == none);
+            for (size_t k = 0; k < actions.size() && allowed; k++) {
+                allowed = !(actions[k] == pair && actions[k].isNoCostlier(pair));
+            }
+            if (allowed && played[j] < played[i]) {
+                MoveAction swapped = actions[j];
+                swapped.play(played[i]);
+                allowed = !(swapped == pair && swapped.counts == pair.counts);
+            }
+            if (!allowed) continue;
+            for (int run = 0; run < runs[i]; run++) {
+                next[firstState[i] + run][played[j]] = firstState[j];
+            }
+        }
+    }
+    successors.resize(numStates);
+    for (int state = 0; state < numStates; state++) {
+        for (size_t i = 0; i < played.size(); i++) {
+            if (next[state][played[i]] >= 0) successors[state].push_back(played[i]);
+        }
+    }
+
+    // Largest relation where every move allowed after other is allowed
+    // after state and leads to states related the same way
+    coverage.assign(numStates, std::vector<bool>(numStates, true));
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int state = 0; state < numStates; state++) {
+            for (int other = 0; other < numStates; other++) {
+                if (!coverage[state][other]) continue;
+                for (size_t i = 0; i < successors[other].size(); i++) {
+                    MoveCode move = successors[other][i];
+                    if (next[state][move] < 0 || !coverage[next[state][move]][next[other][move]]) {
+                        coverage[state][other] = false;
+                        changed = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
+
+int MoveAutomaton::getNumStates() const {
+    return next.size();
+}
+
+CellProgress::CellProgress(const PuzzleState& state) {
+    const StateTables& tables = getTables();
+    for (int cell = 0; cell < 8; cell++) {
+        counts[cell].fill(0);
+    }
+    for (int i = 0; i < NUM_STICKERS; i++) {
+        counts[tables.colors[i]][tables.colors[state.stickers[i]]]++;
+    }
+    solved = 0;
+    for (int cell = 0; cell < 8; cell++) {
+        updateCell(cell);
+    }
+}
+
+void CellProgress::updateCell(int cell) {
+    solved &= ~(1 << cell);
+    for (int color = 0; color < 8; color++) {
+        if (counts[cell][color] == NUM_STICKERS / 8) solved |= 1 << cell;
+    }
+}
+
+void CellProgress::applyMove(PuzzleState& state, MoveCode move) {
+    const StateTables& tables = getTables();
+    const std::vector<unsigned char>& moved = tables.movedStickers[move];
+    for (size_t i = 0; i < moved.size(); i++) {
+        counts[tables.colors[moved[i]]][tables.colors[state.stickers[moved[i]]]]--;
+    }
+    state.applyMove(move);
+    int cells = 0;
+    for (size_t i = 0; i < moved.size(); i++) {
+        counts[tables.colors[moved[i]]][tables.colors[state.stickers[moved[i]]]]++;
+        cells |= 1 << tables.colors[moved[i]];
+    }
+    for (int cell = 0; cell < 8; cell++) {
+        if ((cells >> cell) & 1) updateCell(cell);
+    }
+}
+
+int CellProgress::getSolvedCells() const {
+    return solved;
+}
@@ -0,0 +1,155 @@
+/**************************************************************************
+ * 3to4++ - https://github.com/rayzchen/3to4++
+ *-------------------------------------------------------------------------
+ * Copyright 2024 Ray Chen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ **************************************************************************/
+
+#ifndef STATE_H
+#define STATE_H
+
+#include <array>
+#include <vector>
+#include <string>
+#include "puzzle.h"
+
+// 8 1c, 24 2c, 32 3c and 16 4c pieces
+#define NUM_SLOTS 80
+#define NUM_STICKERS 216
+// Outer slice side, middle slice position and middle slice direction
+#define NUM_CONFIGS 16
+// Files built from the numbering of slots, stickers and move codes are
+// only valid for the same version, so bump it when any of them changes
+#define PUZZLE_CORE_VERSION 1
+
+typedef unsigned char MoveCode;
+
+// Layout of the one byte move codes
+typedef enum : int {
+    MOVE_TURN = 0, // every legal cell turn, ordered by cell then direction
+    MOVE_GYRO = 24, // RIGHT, LEFT, UP, DOWN, FRONT, BACK
+    MOVE_GYRO_OUTER = 30,
+    MOVE_GYRO_MIDDLE = 31, // -1, 0 (direction flip), 1
+    MOVE_ROTATE = 34, // ZY, YZ
+    NUM_MOVES = 36
+} MoveCodeLayout;
+
+// Compact copy of a Puzzle for searching and scrambling. Every sticker
+// position is numbered 0 to NUM_STICKERS - 1, slot by slot in the same
+// order as the Puzzle members, and a state stores which home position
+// the sticker now sitting at each position came from.
+class PuzzleState {
+    public:
+        PuzzleState();
+        PuzzleState(const Puzzle& puzzle);
+        void toPuzzle(Puzzle& puzzle) const;
+        void applyMove(MoveCode move);
+        bool isSolved() const;
+        bool operator==(const PuzzleState& other) const;
+        bool operator!=(const PuzzleState& other) const;
+
+        // Piece coordinates: home slot of the piece in each slot, and the
+        // rank of the permutation of its stickers (0 when oriented)
+        std::array<unsigned char, NUM_SLOTS> getPieces() const;
+        std::array<unsigned char, NUM_SLOTS> getTwists() const;
+        bool setPieces(const std::array<unsigned char, NUM_SLOTS>& pieces,
+                       const std::array<unsigned char, NUM_SLOTS>& twists);
+        // Whole state packed into a mixed radix number, printed in base 64
+        std::string encode() const;
+        bool decode(std::string code);
+
+        MoveEntry getMoveEntry(MoveCode move) const;
+        static MoveCode getMoveCode(MoveEntry entry);
+        // Codes that play a turn or gyro from the current slice config, the
+        // way the controller plays them
+        const std::vector<MoveCode>& expandMove(MoveCode move) const;
+        static const unsigned char* getMovePermutation(MoveCode move);
+        // Slice config of a puzzle, as stored in config
+        static int getConfig(const Puzzle& puzzle);
+        // One bit per code that plays from a config without slice gyros first
+        static unsigned long long getLegalMoves(int config);
+        // Entries the controller plays for a code from a config, slice gyros
+        // first, and the config they leave
+        static const std::vector<MoveEntry>& getMacro(int config, MoveCode move);
+        static int getNextConfig(int config, MoveCode move);
+        static int getSlotSize(int slot);
+        static int getSlotSticker(int slot);
+        // Color of the sticker at a position when solved, which is also the
+        // cell the position belongs to
+        static Color getStickerColor(int sticker);
+        // Slots holding pieces with the given number of stickers
+        static std::vector<int> getOrbit(int size);
+
+        // Lehmer code ranks, up to 20 elements
+        static unsigned long long rankPermutation(const unsigned char* perm, int n);
+        static void unrankPermutation(unsigned long long rank, unsigned char* perm, int n);
+
+        std::array<unsigned char, NUM_STICKERS> stickers;
+        unsigned char config;
+
+    private:
+        friend struct StateTables;
+        static std::array<Piece*, NUM_SLOTS> getSlots(Puzzle& puzzle);
+        static Color& getSticker(Piece& piece, int index);
+        static void setConfig(Puzzle& puzzle, int config);
+};
+
+// How many stickers of each color every cell shows, kept up to date from
+// just the positions each move changes, so that cells becoming solved are
+// seen without checking the whole state after every move
+class CellProgress {
+    public:
+        CellProgress(const PuzzleState& state);
+        // Plays move on the state the counts were kept for
+        void applyMove(PuzzleState& state, MoveCode move);
+        // Bit per cell showing a single color, in any orientation
+        int getSolvedCells() const;
+
+    private:
+        // [cell][color]
+        std::array<std::array<unsigned char, 8>, 8> counts;
+        int solved;
+
+        void updateCell(int cell);
+};
+
+// Table of the move sequences worth searching, as a state machine over the
+// last move played and how many times in a row. Turns and gyros count with
+// the slice gyros expandMove plays for them. A move is left out when it
+// would cancel or merge with the last move, when it commutes with the last
+// move and comes before it, or when repeating it again does what a shorter
+// sequence does. Replacements never cost more in any metric, so some
+// cheapest solution always gets through. Moves that do exactly what an
+// earlier one does are never played.
+class MoveAutomaton {
+    public:
+        MoveAutomaton(const std::vector<MoveCode>& moves);
+        // State before the first move
+        static int getStart() { return 0; }
+        // State after playing move, -1 if the sequence is left out
+        int getNext(int state, MoveCode move) const { return next[state][move]; }
+        // Moves that may be played from a state
+        const std::vector<MoveCode>& getMoves(int state) const { return successors[state]; }
+        int getNumStates() const;
+        // Every sequence allowed after other is allowed after state
+        bool covers(int state, int other) const { return coverage[state][other]; }
+
+    private:
+        std::vector<std::array<short, NUM_MOVES> > next;
+        std::vector<std::vector<MoveCode> > successors;
+        std::vector<std::vector<bool> > coverage;
+};
+
+#endif // state.h
@@ -0,0 +1,241 @@
+/**************************************************************************
+ * 3to4++ - https://github.com/rayzchen/3to4++
+ *-------------------------------------------------------------------------
+ * Copyright 2024 Ray Chen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ **************************************************************************/
+
+
+#include "stats.h"
+#include <cmath>
+#include <cstring>
+#include <iterator>
+
+// Sizes of the averages, as in ao5
+static const size_t averageSizes[NUM_AVERAGES] = {5, 12, 100, 1000};
+
+RollingAverage::RollingAverage(size_t size) {
+    this->size = size;
+    // 5% of the times at each end, rounded up
+    trim = (size + 19) / 20;
+    middleSum = 0;
+    best = -1.0;
+}
+
+void RollingAverage::insert(unsigned int time) {
+    if (!low.empty() && time < *low.rbegin()) {
+        low.insert(time);
+    } else if (!high.empty() && time > *high.begin()) {
+        high.insert(time);
+    } else {
+        middle.insert(time);
+        middleSum += time;
+    }
+}
+
+void RollingAverage::erase(unsigned int time) {
+    if (!low.empty() && time <= *low.rbegin()) {
+        low.erase(low.find(time));
+    } else if (!high.empty() && time >= *high.begin()) {
+        high.erase(high.find(time));
+    } else {
+        middle.erase(middle.find(time));
+        middleSum -= time;
+    }
+}
+
+// Brings both ends back to trim times. Only one time came or went, so
+// this moves at most a couple of times.
+void RollingAverage::balance() {
+    while (low.size() > trim) {
+        std::multiset<unsigned int>::iterator last = std::prev(low.end());
+        middle.insert(*last);
+        middleSum += *last;
+        low.erase(last);
+    }
+    while (high.size() > trim) {
+        middle.insert(*high.begin());
+        middleSum += *high.begin();
+        high.erase(high.begin());
+    }
+    while (low.size() < trim && !middle.empty()) {
+        low.insert(*middle.begin());
+        middleSum -= *middle.begin();
+        middle.erase(middle.begin());
+    }
+    while (high.size() < trim && !middle.empty()) {
+        std::multiset<unsigned int>::iterator last = std::prev(middle.end());
+        high.insert(*last);
+        middleSum -= *last;
+        middle.erase(last);
+    }
+}
+
+void RollingAverage::push(unsigned int time) {
+    window.push_back(time);
+    insert(time);
+    if (window.size() > size) {
+        erase(window.front());
+        window.pop_front();
+    }
+    balance();
+    if (isFull() && (best < 0.0 || getAverage() < best)) best = getAverage();
+}
+
+size_t RollingAverage::getSize() const {
+    return size;
+}
+
+bool RollingAverage::isFull() const {
+    return window.size() == size;
+}
+
+double RollingAverage::getAverage() const {
+    return (double)middleSum / (size - 2 * trim);
+}
+
+double RollingAverage::getBest() const {
+    return best;
+}
+
+SolveStats::SolveStats() {
+    file = NULL;
+    numSolves = 0;
+    totalTime = 0;
+    best = 0;
+    last.date = 0;
+    last.time = 0;
+    last.moves = 0;
+    for (int i = 0; i < NUM_AVERAGES; i++) {
+        averages.push_back(RollingAverage(averageSizes[i]));
+    }
+}
+
+SolveStats::~SolveStats() {
+    close();
+}
+
+// Reads digits at offset, false if there are none
+static bool parseNumber(const unsigned char *data, size_t end, size_t& offset, unsigned long long& value) {
+    size_t start = offset;
+    value = 0;
+    while (offset < end && data[offset] >= '0' && data[offset] <= '9' && offset - start < 19) {
+        value = value * 10 + (data[offset++] - '0');
+    }
+    return offset > start && offset < end && data[offset++] == ' ';
+}
+
+bool SolveStats::open(const std::string& filename) {
+    close();
+    // Lines are a date, a time, a move count and a state code. A line cut
+    // short by a crash is skipped.
+    MappedFile mapping;
+    if (mapping.open(filename)) {
+        const unsigned char *data = mapping.getData();
+        size_t size = mapping.getSize();
+        SolveRecord record;
+        unsigned long long time, moves;
+        for (size_t begin = 0; begin < size;) {
+            const void *newline = memchr(data + begin, '\n', size - begin);
+            if (newline == NULL) break;
+            size_t end = (const unsigned char*)newline - data;
+            size_t offset = begin;
+            if (data[begin] != '#' && parseNumber(data, end, offset, record.date) &&
+                parseNumber(data, end, offset, time) && parseNumber(data, end, offset, moves) && offset < end) {
+                record.time = time;
+                record.moves = moves;
+                record.scramble.assign((const char*)data + offset, end - offset);
+                insert(record);
+            }
+            begin = end + 1;
+        }
+    }
+    // Mapped files cannot be appended to on Windows
+    mapping.close();
+    file = fopen(filename.c_str(), "ab");
+    return file != NULL;
+}
+
+void SolveStats::close() {
+    if (file != NULL) fclose(file);
+    file = NULL;
+}
+
+void SolveStats::insert(const SolveRecord& record) {
+    if (numSolves == 0 || record.time < best) best = record.time;
+    numSolves++;
+    totalTime += record.time;
+    last = record;
+    for (int i = 0; i < NUM_AVERAGES; i++) {
+        averages[i].push(record.time);
+    }
+}
+
+void SolveStats::addSolve(const SolveRecord& record) {
+    insert(record);
+    if (file == NULL) return;
+    std::string line = std::to_string(record.date) + " " + std::to_string(record.time) + " " +
+                       std::to_string(record.moves) + " " + record.scramble + "\n";
+    fputs(line.c_str(), file);
+    fflush(file);
+}
+
+size_t SolveStats::getNumSolves() const {
+    return numSolves;
+}
+
+const SolveRecord& SolveStats::getLastSolve() const {
+    return last;
+}
+
+unsigned int SolveStats::getBest() const {
+    return best;
+}
+
+double SolveStats::getMean() const {
+    if (numSolves == 0) return 0.0;
+    return (double)totalTime / numSolves;
+}
+
+const RollingAverage& SolveStats::getAverage(int index) const {
+    return averages[index];
+}
+
+std::string SolveStats::getSummary() const {
+    std::string summary;
+    for (int i = 0; i < NUM_AVERAGES; i++) {
+        if (!averages[i].isFull()) break;
+        if (!summary.empty()) summary += "  ";
+        summary += "ao" + std::to_string(averages[i].getSize()) + " " + formatTime(averages[i].getAverage());
+    }
+    return summary;
+}
+
+std::string SolveStats::formatTime(double milliseconds) {
+    unsigned long centiseconds = (unsigned long)std::floor(milliseconds / 10.0 + 0.5);
+    unsigned long seconds = centiseconds / 100;
+    char text[32];
+    if (seconds < 60) {
+        snprintf(text, sizeof(text), "%lu.%02lu", seconds, centiseconds % 100);
+    } else {
+        snprintf(text, sizeof(text), "%lu:%02lu.%02lu", seconds / 60, seconds % 60, centiseconds % 100);
+    }
+    return text;
+}
+
+double SolveStats::getTps(const SolveRecord& record) {
+    if (record.time == 0) return 0.0;
+    return record.moves * 1000.0 / record.time;
+}
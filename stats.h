@@ -0,0 +1,111 @@
+/**************************************************************************
+ * 3to4++ - https://github.com/rayzchen/3to4++
+ *-------------------------------------------------------------------------
+ * Copyright 2024 Ray Chen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ **************************************************************************/
+
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <cstdio>
+#include <deque>
+#include <set>
+#include <string>
+#include <vector>
+#include "mapping.h"
+
+// Averages kept over the last solves, as in ao5, ao12, ao100 and ao1000
+#define NUM_AVERAGES 4
+
+struct SolveRecord {
+    // Seconds since the epoch when the solve finished
+    unsigned long long date;
+    // Milliseconds from the first move to the solved puzzle
+    unsigned int time;
+    // Turn count of the history
+    unsigned int moves;
+    // State code the solve started from
+    std::string scramble;
+};
+
+// Mean of the last size times without the fastest and slowest 5% of them,
+// rounded up, as timers trim their averages. The times are split into the
+// trimmed low and high ends and the middle, each sorted, so a new time
+// and the one it pushes out move O(log size) elements between them.
+class RollingAverage {
+    public:
+        RollingAverage(size_t size);
+        void push(unsigned int time);
+        size_t getSize() const;
+        // Only once size times have been pushed
+        bool isFull() const;
+        double getAverage() const;
+        // Best average so far, negative before the first
+        double getBest() const;
+
+    private:
+        size_t size;
+        size_t trim;
+        std::deque<unsigned int> window;
+        std::multiset<unsigned int> low, middle, high;
+        unsigned long long middleSum;
+        double best;
+
+        void insert(unsigned int time);
+        void erase(unsigned int time);
+        void balance();
+};
+
+// Every solve of every session, kept as running statistics and appended to
+// a text file one line per solve, which is read back on the next start
+class SolveStats {
+    public:
+        SolveStats();
+        ~SolveStats();
+        SolveStats(const SolveStats&) = delete;
+        SolveStats& operator=(const SolveStats&) = delete;
+        // Reads the solves already in the file and appends new ones to it.
+        // A missing file is created with the first solve.
+        bool open(const std::string& filename);
+        void close();
+        void addSolve(const SolveRecord& record);
+        size_t getNumSolves() const;
+        const SolveRecord& getLastSolve() const;
+        // Best single and mean of every solve, in milliseconds
+        unsigned int getBest() const;
+        double getMean() const;
+        const RollingAverage& getAverage(int index) const;
+        // Averages that are full, like "ao5 12.34  ao12 13.02"
+        std::string getSummary() const;
+
+        // Seconds to two decimals, with minutes above a minute
+        static std::string formatTime(double milliseconds);
+        // Turns per second of a solve
+        static double getTps(const SolveRecord& record);
+
+    private:
+        FILE *file;
+        size_t numSolves;
+        unsigned long long totalTime;
+        unsigned int best;
+        SolveRecord last;
+        std::vector<RollingAverage> averages;
+
+        void insert(const SolveRecord& record);
+};
+
+#endif // stats.h
@@ -1,4 +1,4 @@
-.PHONY: all run addicon build shared clean realclean
+.PHONY: all run addicon build shared clean realclean tools test
 
 IMGUI_SOURCEFILES = imgui/imgui.cpp \
 					imgui/imgui_draw.cpp \
@@ -64,6 +64,39 @@ endif
 run:	3to4++
 	./3to4++
 
+# Command line tools only need the puzzle core
+CORE_OBJFILES = hsc.o mapping.o movelog.o notation.o puzzle.o scrambler.o solver.o state.o
+TOOL_CPP_FILES = 3to4++-hsc.cpp 3to4++-mixing.cpp 3to4++-pdb.cpp 3to4++-scramble.cpp 3to4++-solve.cpp 3to4++-subgroup.cpp
+
+tools:	3to4++-hsc 3to4++-mixing 3to4++-pdb 3to4++-scramble 3to4++-solve 3to4++-subgroup
+
+3to4++-hsc:	3to4++-hsc.o $(CORE_OBJFILES)
+	$(CXX) $(CXXFLAGS) -o 3to4++-hsc 3to4++-hsc.o $(CORE_OBJFILES) -pthread
+
+3to4++-mixing:	3to4++-mixing.o $(CORE_OBJFILES)
+	$(CXX) $(CXXFLAGS) -o 3to4++-mixing 3to4++-mixing.o $(CORE_OBJFILES) -pthread
+
+3to4++-pdb:	3to4++-pdb.o $(CORE_OBJFILES)
+	$(CXX) $(CXXFLAGS) -o 3to4++-pdb 3to4++-pdb.o $(CORE_OBJFILES) -pthread
+
+3to4++-scramble:	3to4++-scramble.o $(CORE_OBJFILES)
+	$(CXX) $(CXXFLAGS) -o 3to4++-scramble 3to4++-scramble.o $(CORE_OBJFILES) -pthread
+
+3to4++-solve:	3to4++-solve.o $(CORE_OBJFILES)
+	$(CXX) $(CXXFLAGS) -o 3to4++-solve 3to4++-solve.o $(CORE_OBJFILES) -pthread
+
+3to4++-subgroup:	3to4++-subgroup.o $(CORE_OBJFILES)
+	$(CXX) $(CXXFLAGS) -o 3to4++-subgroup 3to4++-subgroup.o $(CORE_OBJFILES) -pthread
+
+# Checks of the puzzle core, which exit with an error when one fails
+TEST_CPP_FILES = test-hint.cpp
+
+test:	test-hint
+	./test-hint
+
+test-hint:	test-hint.o hint.o $(CORE_OBJFILES)
+	$(CXX) $(CXXFLAGS) -o test-hint test-hint.o hint.o $(CORE_OBJFILES) -pthread
+
 build:	clean all
 	rm -rf 3to4pp
 	mkdir 3to4pp
@@ -87,6 +120,6 @@ release:
 
 emscripten:
 	rm -rf web/3to4++*
-	em++ $(CPPFLAGS) $(CPP_FILES) $(C_FILES) $(IMGUI_SOURCEFILES) \
+	em++ $(CPPFLAGS) $(filter-out $(TOOL_CPP_FILES) $(TEST_CPP_FILES),$(CPP_FILES)) $(C_FILES) $(IMGUI_SOURCEFILES) \
 		-o web/3to4++.js -sMAX_WEBGL_VERSION=3 -sFILESYSTEM=0 \
 		-flto --closure 1 -sENVIRONMENT=web
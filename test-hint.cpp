@@ -0,0 +1,76 @@
+/**************************************************************************
+ * 3to4++ - https://github.com/rayzchen/3to4++
+ *-------------------------------------------------------------------------
+ * Copyright 2024 Ray Chen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ **************************************************************************/
+
+#include "hint.h"
+#include "scrambler.h"
+#include <iostream>
+
+// Scrambles short enough that hints are expected to find their way back
+#define SCRAMBLE_LENGTH 5
+#define NUM_SCRAMBLES 6
+// Hints followed before giving up, well over what the scrambles need
+#define MAX_HINTS 50
+// Search nodes per hint, about what the program's time budget allows, so
+// the results do not depend on the machine or the build
+#ifndef HINT_NODES
+#define HINT_NODES 50000
+#endif
+
+// Follows hints from a scramble, true once they reach the goal
+static bool followHints(const PuzzleState& scrambled, const HintGoal& goal, int& hints) {
+    HintEngine engine;
+    engine.setGoal(goal);
+    engine.setNodeBudget(HINT_NODES);
+    PuzzleState state = scrambled;
+    MoveCode move;
+    for (hints = 0; hints < MAX_HINTS; hints++) {
+        if (!engine.getHint(state, 0.0, move)) return engine.getDistance(state) == 0;
+        state.applyMove(move);
+    }
+    return false;
+}
+
+int main(int argc, char *argv[]) {
+    HintGoal goals[] = {{HINT_SOLVE, 0}, {HINT_COLOR, 2}, {HINT_CELL, 1}};
+    const char *names[] = {"puzzle", "color 2", "cell 1"};
+    int failures = 0;
+    for (size_t i = 0; i < sizeof(goals) / sizeof(goals[0]); i++) {
+        for (int seed = 1; seed <= NUM_SCRAMBLES; seed++) {
+            SplitMix64 rng(seed, 0);
+            std::vector<MoveEntry> scramble = Scrambler::randomMoves(SCRAMBLE_LENGTH, rng);
+            PuzzleState state;
+            for (size_t j = 0; j < scramble.size(); j++) {
+                const std::vector<MoveCode>& moves = state.expandMove(PuzzleState::getMoveCode(scramble[j]));
+                for (size_t k = 0; k < moves.size(); k++) {
+                    state.applyMove(moves[k]);
+                }
+            }
+            int hints;
+            bool reached = followHints(state, goals[i], hints);
+            std::cout << names[i] << ", scramble " << seed << ": ";
+            if (reached) {
+                std::cout << "reached in " << hints << " hints\n";
+            } else {
+                std::cout << "FAILED after " << hints << " hints\n";
+                failures++;
+            }
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
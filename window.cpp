@@ -123,6 +123,8 @@ void Window::setCallbacks() {
     });
     glfwSetKeyCallback(window, [](GLFWwindow* window, int key, int scancode, int action, int mods) {
         Window::current->keyCallback(window, key, scancode, action, mods);
+        // Keys typed into a text field are not moves
+        if (Window::current->gui->captureKeyboard()) return;
         Window::current->gui->keyCallback(window, key, action, mods);
         Window::current->controller->keyCallback(window, key, action, mods, Window::current->camera->inputFlipped());
     });